@@ -2,7 +2,6 @@
 #include "Box.h"
 #include "AABBCollider.h"
 #include "Vectors.h"
-#include "Display.h"
 
 
 AABBCollider::AABBCollider() {
@@ -12,7 +11,6 @@ AABBCollider::AABBCollider() {
 	glm::vec4 color(1.0f, 0.647f, 0.0f, 1.0f);
 
 	box = new Box(center, halfExtents, color);
-	renderer = new BoxRender(box);
 }
 
 AABBCollider::AABBCollider(Vec3 center) : center(center) {
@@ -20,15 +18,13 @@ AABBCollider::AABBCollider(Vec3 center) : center(center) {
 	glm::vec4 color(1.0f, 0.647f, 0.0f, 1.0f);
 
 	box = new Box(center, halfExtents, color);
-	renderer = new BoxRender(box);
 }
 
 AABBCollider::~AABBCollider() {
 	delete box;
-	delete renderer;
 }
 
-void AABBCollider::resolveCollision(ClothData* data) {
+bool AABBCollider::closestSurface(Vec3 P, Vec3& surface, Vec3& normal) {
 
 	float minX = center.x - halfExtents.x;
 	float maxX = center.x + halfExtents.x;
@@ -44,39 +40,41 @@ void AABBCollider::resolveCollision(ClothData* data) {
 
 	float epsilon = 0.15f;
 
-#pragma omp parallel for
-	for (int i = 0; i < data->nodes.size(); ++i) {
-		Vec3 P = data->getWorldPos(data->nodes[i]);
+	if (!(P.x > minX - epsilon && P.x < maxX + epsilon &&
+		P.y > minY - epsilon && P.y < maxY + epsilon &&
+		P.z > minZ - epsilon && P.z < maxZ + epsilon)) {
+		return false; // Node is outside the AABB
+	}
 
-		if (!(P.x > minX - epsilon && P.x < maxX + epsilon &&
-			P.y > minY - epsilon && P.y < maxY + epsilon &&
-			P.z > minZ - epsilon && P.z < maxZ + epsilon)) {
-			continue; // Node is outside the AABB
-		}
 
+	FaceInfo candidates[6] = {
+		{ std::abs(P.x - minX), Vec3(-1, 0, 0) }, // x-
+		{ std::abs(maxX - P.x), Vec3(1, 0, 0) },  // x+
+		{ std::abs(P.y - minY), Vec3(0, -1, 0) }, // y-
+		{ std::abs(maxY - P.y), Vec3(0, 1, 0) },  // y+
+		{ std::abs(P.z - minZ), Vec3(0, 0, -1) }, // z-
+		{ std::abs(maxZ - P.z), Vec3(0, 0, 1) }   // z+
+	};
 
-		FaceInfo candidates[6] = {
-			{ std::abs(P.x - minX), Vec3(-1, 0, 0) }, // x-
-			{ std::abs(maxX - P.x), Vec3(1, 0, 0) },  // x+
-			{ std::abs(P.y - minY), Vec3(0, -1, 0) }, // y-
-			{ std::abs(maxY - P.y), Vec3(0, 1, 0) },  // y+
-			{ std::abs(P.z - minZ), Vec3(0, 0, -1) }, // z-
-			{ std::abs(maxZ - P.z), Vec3(0, 0, 1) }   // z+
-		};
-
-		FaceInfo closest = candidates[0];
-		for (int j = 1; j < 6; j++) {
-			if (candidates[j].distance < closest.distance) {
-				closest = candidates[j];
-			}
+	FaceInfo closest = candidates[0];
+	for (int j = 1; j < 6; j++) {
+		if (candidates[j].distance < closest.distance) {
+			closest = candidates[j];
 		}
-
-		data->setWorldPos(data->nodes[i], P + closest.normal * (closest.distance * 1.05));
-		data->nodes[i]->velocity = data->nodes[i]->velocity * box->friction;
 	}
-}
 
+	surface = P + closest.normal * (closest.distance * 1.05);
+	normal = closest.normal;
+	return true;
+}
 
-void AABBCollider::render() {
-	renderer->flush();
-}
\ No newline at end of file
+void AABBCollider::resolveCollision(ClothData* data) {
+#pragma omp parallel for
+	for (int i = 0; i < data->particles.size(); ++i) {
+		Vec3 surface, normal;
+		if (closestSurface(data->getWorldPos(i), surface, normal)) {
+			data->setWorldPos(i, surface);
+			data->particles.velocity[i] = data->particles.velocity[i] * box->friction;
+		}
+	}
+}
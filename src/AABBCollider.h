@@ -6,8 +6,6 @@
 #include "ICollider.h"
 #include "Vectors.h"
 
-class BoxRender;
-
 class AABBCollider : public ICollider {
 public:
     Vec3 center;
@@ -15,12 +13,11 @@ public:
     glm::vec4 color;
 
     Box* box;
-	BoxRender* renderer;
 
     AABBCollider();
     AABBCollider(Vec3 center);
     void resolveCollision(ClothData* data) override;
-    void render() override;
+    bool closestSurface(Vec3 p, Vec3& surface, Vec3& normal) override;
     ~AABBCollider();
 };
 
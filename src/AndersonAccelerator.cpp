@@ -0,0 +1,52 @@
+#include "AndersonAccelerator.h"
+
+AndersonAccelerator::AndersonAccelerator() :
+    window(5),
+    count(0),
+    head(0)
+{}
+
+void AndersonAccelerator::reset()
+{
+    prevF.resize(0);
+    prevG.resize(0);
+    count = 0;
+    head = 0;
+}
+
+void AndersonAccelerator::compute(const double* x, const double* g, double* out, size_t n)
+{
+    Eigen::Map<const Eigen::VectorXd> X(x, n);
+    Eigen::Map<const Eigen::VectorXd> G(g, n);
+    Eigen::Map<Eigen::VectorXd> Out(out, n);
+    Eigen::VectorXd F = G - X;
+
+    if (dF.rows() != (Eigen::Index)n || dF.cols() != window) {
+        dF.resize(n, window);
+        dG.resize(n, window);
+        count = 0;
+        head = 0;
+    }
+
+    if (prevF.size() == (Eigen::Index)n) {
+        dF.col(head) = F - prevF;
+        dG.col(head) = G - prevG;
+        head = (head + 1) % window;
+        if (count < window) count++;
+    }
+    prevF = F;
+    prevG = G;
+
+    if (count == 0) {
+        Out = G;
+        return;
+    }
+
+    // min |F - dF * gamma|, through the small normal equations
+    Eigen::MatrixXd A = dF.leftCols(count).transpose() * dF.leftCols(count);
+    Eigen::VectorXd rhs = dF.leftCols(count).transpose() * F;
+    A.diagonal().array() += 1e-10 * A.diagonal().maxCoeff() + 1e-30;
+    Eigen::VectorXd gamma = A.ldlt().solve(rhs);
+
+    Out = G - dG.leftCols(count) * gamma;
+}
@@ -0,0 +1,30 @@
+#ifndef ANDERSON_ACCELERATOR_H
+#define ANDERSON_ACCELERATOR_H
+
+#include <cstddef>
+#include <Eigen/Dense>
+
+// Anderson acceleration (type II) for a fixed-point iteration x <- G(x).
+// Keeps the differences of the last `window` residuals F = G(x) - x and of
+// the G values, and returns the combination of G values whose residual has
+// the smallest norm.
+class AndersonAccelerator {
+public:
+    int window;
+
+    AndersonAccelerator();
+    void reset();
+
+    // x is the current iterate, g = G(x); the accelerated iterate goes to out
+    void compute(const double* x, const double* g, double* out, size_t n);
+
+private:
+    Eigen::MatrixXd dF; // Columns: F_{k} - F_{k-1}, ring buffer
+    Eigen::MatrixXd dG; // Columns: G_{k} - G_{k-1}
+    Eigen::VectorXd prevF;
+    Eigen::VectorXd prevG;
+    int count; // Stored columns
+    int head;  // Next column to overwrite
+};
+
+#endif
@@ -0,0 +1,162 @@
+#include <algorithm>
+
+#include "BlockSparseMatrix.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+BlockSparseMatrix::BlockSparseMatrix() {}
+
+void BlockSparseMatrix::buildPattern(const SpringData& springs, size_t nodeCount)
+{
+	std::vector<std::vector<unsigned int>> columns(nodeCount);
+	for (unsigned int n = 0; n < nodeCount; n++)
+		columns[n].push_back(n);
+	for (unsigned int s = 0; s < springs.size(); s++) {
+		columns[springs.node1[s]].push_back(springs.node2[s]);
+		columns[springs.node2[s]].push_back(springs.node1[s]);
+	}
+
+	rowOffset.assign(nodeCount + 1, 0);
+	colIndex.clear();
+	diagIndex.resize(nodeCount);
+	for (unsigned int n = 0; n < nodeCount; n++) {
+		std::vector<unsigned int>& cols = columns[n];
+		std::sort(cols.begin(), cols.end());
+		cols.erase(std::unique(cols.begin(), cols.end()), cols.end());
+
+		for (unsigned int c : cols) {
+			if (c == n)
+				diagIndex[n] = (unsigned int)colIndex.size();
+			colIndex.push_back(c);
+		}
+		rowOffset[n + 1] = (unsigned int)colIndex.size();
+	}
+
+	blocks.assign(colIndex.size(), Mat3x3());
+}
+
+int BlockSparseMatrix::findBlock(unsigned int row, unsigned int col) const
+{
+	const unsigned int* begin = colIndex.data() + rowOffset[row];
+	const unsigned int* end = colIndex.data() + rowOffset[row + 1];
+	const unsigned int* it = std::lower_bound(begin, end, col);
+	if (it == end || *it != col)
+		return -1;
+	return (int)(it - colIndex.data());
+}
+
+void BlockSparseMatrix::multiply(const double* x, double* y) const
+{
+	// y = A x, one block row per iteration, no shared writes. A block is
+	// nine row-major doubles, multiplied lane-wise by x_c laid out as
+	// (x0 x1 x2 x0 | x1 x2 x0 x1 | x2); the row sums wait for the end of
+	// the block row. Only whole blocks and x_c are loaded, no overreads.
+#pragma omp parallel for
+	for (int r = 0; r < (int)rows(); r++) {
+		double p[9];
+		unsigned int k = rowOffset[r];
+#if defined(__AVX__)
+		__m256d acc0 = _mm256_setzero_pd();
+		__m256d acc1 = _mm256_setzero_pd();
+		double acc2 = 0.0;
+		for (; k < rowOffset[r + 1]; k++) {
+			const double* b = blocks[k].data;
+			const double* xc = x + colIndex[k] * 3;
+			__m128d x01 = _mm_loadu_pd(xc);
+			__m128d x20 = _mm_unpacklo_pd(_mm_load_sd(xc + 2), x01);
+			__m128d x12 = _mm_loadu_pd(xc + 1);
+			__m256d xa = _mm256_insertf128_pd(_mm256_castpd128_pd256(x01), x20, 1);
+			__m256d xb = _mm256_insertf128_pd(_mm256_castpd128_pd256(x12), x01, 1);
+			acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(b), xa));
+			acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(b + 4), xb));
+			acc2 += b[8] * xc[2];
+		}
+		_mm256_storeu_pd(p, acc0);
+		_mm256_storeu_pd(p + 4, acc1);
+		p[8] = acc2;
+#elif defined(_M_X64) || defined(__SSE2__)
+		__m128d acc0 = _mm_setzero_pd();
+		__m128d acc1 = _mm_setzero_pd();
+		__m128d acc2 = _mm_setzero_pd();
+		__m128d acc3 = _mm_setzero_pd();
+		double acc4 = 0.0;
+		for (; k < rowOffset[r + 1]; k++) {
+			const double* b = blocks[k].data;
+			const double* xc = x + colIndex[k] * 3;
+			__m128d x01 = _mm_loadu_pd(xc);
+			__m128d x20 = _mm_unpacklo_pd(_mm_load_sd(xc + 2), x01);
+			__m128d x12 = _mm_loadu_pd(xc + 1);
+			acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(b), x01));
+			acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(b + 2), x20));
+			acc2 = _mm_add_pd(acc2, _mm_mul_pd(_mm_loadu_pd(b + 4), x12));
+			acc3 = _mm_add_pd(acc3, _mm_mul_pd(_mm_loadu_pd(b + 6), x01));
+			acc4 += b[8] * xc[2];
+		}
+		_mm_storeu_pd(p, acc0);
+		_mm_storeu_pd(p + 2, acc1);
+		_mm_storeu_pd(p + 4, acc2);
+		_mm_storeu_pd(p + 6, acc3);
+		p[8] = acc4;
+#else
+		for (int e = 0; e < 9; e++)
+			p[e] = 0.0;
+		for (; k < rowOffset[r + 1]; k++) {
+			const double* b = blocks[k].data;
+			const double* xc = x + colIndex[k] * 3;
+			for (int e = 0; e < 9; e++)
+				p[e] += b[e] * xc[e % 3];
+		}
+#endif
+		y[r * 3 + 0] = p[0] + p[1] + p[2];
+		y[r * 3 + 1] = p[3] + p[4] + p[5];
+		y[r * 3 + 2] = p[6] + p[7] + p[8];
+	}
+}
+
+void BlockSparseMatrix::toEigen(Eigen::SparseMatrix<double>& out)
+{
+	// All nine entries of every block, zeros included
+	std::vector<Eigen::Triplet<double>> triplets;
+	triplets.reserve(blocks.size() * 9);
+	for (unsigned int r = 0; r < rows(); r++) {
+		for (unsigned int k = rowOffset[r]; k < rowOffset[r + 1]; k++) {
+			for (int i = 0; i < 3; i++) {
+				for (int j = 0; j < 3; j++)
+					triplets.push_back(Eigen::Triplet<double>(r * 3 + i, colIndex[k] * 3 + j, blocks[k](i, j)));
+			}
+		}
+	}
+	out.resize(rows() * 3, rows() * 3);
+	out.setFromTriplets(triplets.begin(), triplets.end());
+	out.makeCompressed();
+
+	// Where every entry went: out is column major, rows sorted per column
+	const int* inner = out.innerIndexPtr();
+	const int* outer = out.outerIndexPtr();
+	eigenSlots.resize(blocks.size() * 9);
+	for (unsigned int r = 0; r < rows(); r++) {
+		for (unsigned int k = rowOffset[r]; k < rowOffset[r + 1]; k++) {
+			for (int i = 0; i < 3; i++) {
+				for (int j = 0; j < 3; j++) {
+					int col = colIndex[k] * 3 + j;
+					eigenSlots[k * 9 + i * 3 + j] = (int)(std::lower_bound(inner + outer[col], inner + outer[col + 1], (int)(r * 3 + i)) - inner);
+				}
+			}
+		}
+	}
+}
+
+void BlockSparseMatrix::updateEigen(Eigen::SparseMatrix<double>& out) const
+{
+	double* values = out.valuePtr();
+#pragma omp parallel for
+	for (int k = 0; k < (int)blocks.size(); k++) {
+		const int* slots = &eigenSlots[k * 9];
+		for (int e = 0; e < 9; e++)
+			values[slots[e]] = blocks[k][e];
+	}
+}
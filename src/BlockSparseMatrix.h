@@ -0,0 +1,39 @@
+#ifndef BLOCK_SPARSE_MATRIX_H
+#define BLOCK_SPARSE_MATRIX_H
+
+#include <vector>
+#include "ParticleData.h"
+#include "SpringData.h"
+#include "Matrices.h"
+#include <Eigen/Sparse>
+
+// Block sparse row (BSR) matrix of 3x3 dense blocks, one block row and column
+// per node. Block row r owns blocks [rowOffset[r], rowOffset[r + 1]), sorted by
+// column, with one column index per block instead of nine.
+class BlockSparseMatrix {
+public:
+    AlignedVector<unsigned int> rowOffset;
+    AlignedVector<unsigned int> colIndex;
+    AlignedVector<unsigned int> diagIndex; // Block index of (r, r)
+    AlignedVector<Mat3x3>       blocks;
+    std::vector<int>            eigenSlots; // 9 offsets per block into the values of the last toEigen
+
+    BlockSparseMatrix();
+    size_t rows() const { return diagIndex.size(); }
+    size_t nonZeroBlocks() const { return blocks.size(); }
+
+    // Diagonal block per node plus one block per pair of nodes joined by a spring
+    void buildPattern(const SpringData& springs, size_t nodeCount);
+    int findBlock(unsigned int row, unsigned int col) const;
+
+    // y = A x: block rows split across threads, SSE2/AVX inside a block
+    void multiply(const double* x, double* y) const;
+
+    // Scalar copy for the direct solvers. Every block is stored in full, so
+    // the pattern only changes with the block pattern: after one toEigen,
+    // updateEigen refreshes the values in place.
+    void toEigen(Eigen::SparseMatrix<double>& out);
+    void updateEigen(Eigen::SparseMatrix<double>& out) const;
+};
+
+#endif
@@ -1,3 +1,5 @@
+#include <cstdio>
+#include <cstdlib>
 #include "Capsule.h"
 #include "glm/glm.hpp"
 #include "Vertex.h"
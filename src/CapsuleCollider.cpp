@@ -3,7 +3,6 @@
 #include "CapsuleCollider.h"
 #include "Capsule.h"
 #include "Vectors.h"
-#include "Display.h"
 
 CapsuleCollider::CapsuleCollider() {
 	//center1 = Vec3(0.0f, -1.0f, -5.0f)
@@ -14,7 +13,6 @@ CapsuleCollider::CapsuleCollider() {
 	color = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
 
 	capsule = new Capsule(top, bottom, radius, color);
-	renderer = new CapsuleRender(capsule);
 }
 
 CapsuleCollider::CapsuleCollider(Vec3 top, Vec3 bottom) : top(top), bottom(bottom) {
@@ -22,51 +20,50 @@ CapsuleCollider::CapsuleCollider(Vec3 top, Vec3 bottom) : top(top), bottom(botto
 	color = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
 
 	capsule = new Capsule(top, bottom, radius, color);
-	renderer = new CapsuleRender(capsule);
 }
 
 CapsuleCollider::~CapsuleCollider() {
 	delete capsule;
-	delete renderer;
 }
 
-void CapsuleCollider::resolveCollision(ClothData* data) {
-#pragma omp parallel for
-	for (int i = 0; i < data->nodes.size(); ++i) {
-		// point
-		Vec3 P = data->getWorldPos(data->nodes[i]);
-		
+bool CapsuleCollider::closestSurface(Vec3 P, Vec3& surface, Vec3& normal) {
+	// top -> point
+	Vec3 AP = P - capsule->centerTopHemisphere;
 
-		// top -> point
-		Vec3 AP = P - capsule->centerTopHemisphere;
+	// top -> bottom
+	Vec3 AB = capsule->centerBottomHemisphere - capsule->centerTopHemisphere;
 
-		// top -> bottom
-		Vec3 AB = capsule->centerBottomHemisphere - capsule->centerTopHemisphere;
+	double F = Vec3::dot(AP, AB) / Vec3::dot(AB, AB);
 
-		double F = Vec3::dot(AP, AB) / Vec3::dot(AB, AB);
+	// closest point
+	Vec3 C = capsule->centerTopHemisphere + AB * (double)glm::clamp(F, 0.0, 1.0);
 
-		// closest point
-		Vec3 C = capsule->centerTopHemisphere + AB * (double)glm::clamp(F, 0.0, 1.0);
+	Vec3 distVec = P - C;
+	double dist = distVec.length();
+	float safeDist = radius * 1.05;
 
-		Vec3 distVec = P - C;
-		double dist = distVec.length();
-		float safeDist = radius * 1.05;
+	double distLenSemiSphereTop = (C - capsule->centerTopHemisphere).length() < radius ? (C - P).length() : radius;
+	double distLenSemiSphereBottom = (C - bottom).length() < radius ? (C - P).length() : radius;
+	if (distLenSemiSphereTop < radius || distLenSemiSphereBottom < radius) {
+		safeDist = distLenSemiSphereTop < distLenSemiSphereBottom ? distLenSemiSphereTop : distLenSemiSphereBottom * 1.05;
+	}
 
-		double distLenSemiSphereTop = (C - capsule->centerTopHemisphere).length() < radius ? (C - P).length() : radius;
-		double distLenSemiSphereBottom = (C - bottom).length() < radius ? (C - P).length() : radius;
-		if (distLenSemiSphereTop < radius || distLenSemiSphereBottom < radius) {
-			safeDist = distLenSemiSphereTop < distLenSemiSphereBottom ? distLenSemiSphereTop : distLenSemiSphereBottom * 1.05;
-		}
+	if (dist >= safeDist)
+		return false;
 
-		if (dist < safeDist) {
-			distVec.normalize();
-			data->setWorldPos(data->nodes[i], distVec * safeDist + C);
-			data->nodes[i]->velocity = data->nodes[i]->velocity * capsule->friction;
-		}
+	distVec.normalize();
+	surface = distVec * safeDist + C;
+	normal = distVec;
+	return true;
+}
 
+void CapsuleCollider::resolveCollision(ClothData* data) {
+#pragma omp parallel for
+	for (int i = 0; i < data->particles.size(); ++i) {
+		Vec3 surface, normal;
+		if (closestSurface(data->getWorldPos(i), surface, normal)) {
+			data->setWorldPos(i, surface);
+			data->particles.velocity[i] = data->particles.velocity[i] * capsule->friction;
+		}
 	}
 }
-
-void CapsuleCollider::render() {
-	renderer->flush();
-}
\ No newline at end of file
@@ -6,8 +6,6 @@
 #include "Capsule.h"
 #include "Vectors.h"
 
-class CapsuleRender;
-
 class CapsuleCollider : public ICollider {
 public:
     Vec3 top;
@@ -16,12 +14,11 @@ public:
     glm::vec4 color;
 
     Capsule* capsule;
-	CapsuleRender* renderer;
 
     CapsuleCollider();
     CapsuleCollider(Vec3 top, Vec3 bottom);
     void resolveCollision(ClothData* data) override;
-    void render() override;
+    bool closestSurface(Vec3 p, Vec3& surface, Vec3& normal) override;
     ~CapsuleCollider();
 };
 
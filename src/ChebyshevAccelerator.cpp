@@ -0,0 +1,77 @@
+#include <cmath>
+#include <algorithm>
+#include "ChebyshevAccelerator.h"
+
+ChebyshevAccelerator::ChebyshevAccelerator() :
+    delay(2),
+    gamma(0.9),
+    rho(0.0),
+    omega(1.0),
+    start(0),
+    lastUpdate(0.0)
+{}
+
+void ChebyshevAccelerator::setSpectralRadius(double r)
+{
+    rho = std::min(std::max(r, 0.0), 0.9999);
+}
+
+void ChebyshevAccelerator::apply(int k, double* x, size_t n)
+{
+    if (k == 0) {
+        // First iterate of a solve, nothing to extrapolate from yet
+        prev.assign(x, x + n);
+        prevPrev = prev;
+        omega = 1.0;
+        start = 0;
+        lastUpdate = 0.0;
+        return;
+    }
+
+    double update = 0.0;
+#pragma omp parallel for reduction(+:update)
+    for (int i = 0; i < (int)n; i++) {
+        update += (x[i] - prev[i]) * (x[i] - prev[i]);
+    }
+    update = sqrt(update);
+
+    // Safeguard: a growing plain update means the extrapolation overshoots
+    // (rho too large for this nonlinear step), restart the recurrence
+    int j = k - start;
+    if (j > delay && update > lastUpdate) {
+        start = k;
+        j = 0;
+    }
+    lastUpdate = update;
+
+    if (j < delay)
+        omega = 1.0;
+    else if (j == delay)
+        omega = 2.0 / (2.0 - rho * rho);
+    else
+        omega = 4.0 / (4.0 - rho * rho * omega);
+
+    if (j >= delay) {
+#pragma omp parallel for
+        for (int i = 0; i < (int)n; i++) {
+            x[i] = omega * (gamma * (x[i] - prev[i]) + prev[i] - prevPrev[i]) + prevPrev[i];
+        }
+    }
+
+    prevPrev.swap(prev);
+    prev.assign(x, x + n);
+}
+
+double ChebyshevAccelerator::estimateSpectralRadius(const std::vector<double>& updateNorms)
+{
+    // Geometric mean decay over the second half of the run
+    if (updateNorms.size() < 3)
+        return 0.0;
+
+    size_t last = updateNorms.size() - 1;
+    size_t mid = last / 2;
+    if (updateNorms[mid] <= 0.0 || updateNorms[last] <= 0.0)
+        return 0.0;
+
+    return std::pow(updateNorms[last] / updateNorms[mid], 1.0 / (double)(last - mid));
+}
@@ -0,0 +1,36 @@
+#ifndef CHEBYSHEV_ACCELERATOR_H
+#define CHEBYSHEV_ACCELERATOR_H
+
+#include <vector>
+#include <cstddef>
+
+// Chebyshev semi-iterative acceleration (Wang 2015) for a fixed-point solver
+// q^{k+1} = F(q^k). After every plain iteration the new iterate is replaced by
+//   q^{k+1} = omega * (gamma * (q^{k+1} - q^k) + q^k - q^{k-1}) + q^{k-1}
+// with omega following the Chebyshev recurrence for spectral radius rho.
+class ChebyshevAccelerator {
+public:
+    int delay;    // Plain iterations before the acceleration starts
+    double gamma; // Under-relaxation of the plain update
+
+    ChebyshevAccelerator();
+    void setSpectralRadius(double r);
+    double getSpectralRadius() const { return rho; }
+
+    // k is the 0-based iteration that just produced x (n values)
+    void apply(int k, double* x, size_t n);
+
+    // Estimate rho from the norms of successive updates |q^{k+1} - q^k| of a
+    // plain run: they decay like rho^k once the slowest mode dominates
+    static double estimateSpectralRadius(const std::vector<double>& updateNorms);
+
+private:
+    double rho;
+    double omega;
+    int start;         // Iteration the recurrence (re)started at
+    double lastUpdate; // |q^k - q^{k-1}| of the previous plain iteration
+    std::vector<double> prev;     // q^k
+    std::vector<double> prevPrev; // q^{k-1}
+};
+
+#endif
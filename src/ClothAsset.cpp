@@ -0,0 +1,237 @@
+#include <omp.h>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "ClothAsset.h"
+#include "ClothData.h"
+#include "MappedFile.h"
+
+namespace {
+
+enum Section { POSITION, TEXCOORD, TANGENT, FACES, NODE1, NODE2, REST_LENGTH, TYPE, PINNED, SECTIONS };
+
+const char MAGIC[8] = { 'C', 'L', 'O', 'T', 'H', 'B', 'I', 'N' };
+const size_t ALIGNMENT = 16;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t sourceSize; // Source mesh stamp, 0 for none
+    int64_t sourceTime;
+    uint32_t nodeCount;
+    uint32_t triangleCount;
+    uint32_t springCount;
+    uint32_t pinCount;
+    int32_t nodesPerRow;
+    int32_t nodesPerCol;
+    int32_t nodesDensity;
+    int32_t reserved;
+    double clothPos[3];
+    uint64_t offset[SECTIONS]; // From the start of the file
+};
+
+static_assert(sizeof(Vec3) == 3 * sizeof(double) && sizeof(Vec2) == 2 * sizeof(double),
+    "Vec3 and Vec2 streams are stored as packed doubles");
+
+size_t sectionSize(const Header& h, int section)
+{
+    switch (section) {
+    case POSITION:
+    case TANGENT: return (size_t)h.nodeCount * sizeof(Vec3);
+    case TEXCOORD: return (size_t)h.nodeCount * sizeof(Vec2);
+    case FACES: return (size_t)h.triangleCount * 3 * sizeof(uint32_t);
+    case NODE1:
+    case NODE2: return (size_t)h.springCount * sizeof(uint32_t);
+    case REST_LENGTH: return (size_t)h.springCount * sizeof(double);
+    case TYPE: return (size_t)h.springCount;
+    case PINNED: return (size_t)h.pinCount * sizeof(uint32_t);
+    }
+    return 0;
+}
+
+}
+
+std::string ClothAsset::pathFor(const std::string& source)
+{
+    size_t dot = source.find_last_of('.');
+    size_t slash = source.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return source + ".clothbin";
+    return source.substr(0, dot) + ".clothbin";
+}
+
+bool ClothAsset::sourceStamp(const std::string& source, uint64_t& size, int64_t& time)
+{
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(source.c_str(), &st) != 0)
+        return false;
+#else
+    struct stat st;
+    if (stat(source.c_str(), &st) != 0)
+        return false;
+#endif
+    size = (uint64_t)st.st_size;
+    time = (int64_t)st.st_mtime;
+    return true;
+}
+
+bool ClothAsset::save(const ClothData& cloth, const std::string& path, const std::string& source, std::string& error)
+{
+    const ParticleData& p = cloth.particles;
+    const SpringData& s = cloth.springs;
+
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.headerSize = sizeof(Header);
+    if (!source.empty() && !sourceStamp(source, h.sourceSize, h.sourceTime)) {
+        error = "can't stat " + source;
+        return false;
+    }
+    h.nodeCount = (uint32_t)p.size();
+    h.triangleCount = (uint32_t)(cloth.faces.size() / 3);
+    h.springCount = (uint32_t)s.size();
+    h.pinCount = (uint32_t)cloth.pinnedNodes.size();
+    h.nodesPerRow = cloth.nodesPerRow;
+    h.nodesPerCol = cloth.nodesPerCol;
+    h.nodesDensity = cloth.nodesDensity;
+    h.clothPos[0] = cloth.clothPos.x;
+    h.clothPos[1] = cloth.clothPos.y;
+    h.clothPos[2] = cloth.clothPos.z;
+
+    const void* data[SECTIONS] = {
+        p.position.data(), p.texCoord.data(), p.tangent.data(), cloth.faces.data(),
+        s.node1.data(), s.node2.data(), s.restLen.data(), s.type.data(), cloth.pinnedNodes.data()
+    };
+    uint64_t offset = (sizeof(Header) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    for (int i = 0; i < SECTIONS; i++) {
+        h.offset[i] = offset;
+        offset = (offset + sectionSize(h, i) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        error = "can't write " + path;
+        return false;
+    }
+    const char zeros[ALIGNMENT] = {};
+    file.write((const char*)&h, sizeof(h));
+    uint64_t written = sizeof(h);
+    for (int i = 0; i < SECTIONS; i++) {
+        file.write(zeros, h.offset[i] - written);
+        file.write((const char*)data[i], sectionSize(h, i));
+        written = h.offset[i] + sectionSize(h, i);
+    }
+    file.write(zeros, offset - written);
+    if (!file) {
+        error = "can't write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool ClothAsset::load(const std::string& path, const std::string& source, ClothData& cloth, std::string& error)
+{
+    MappedFile file;
+    if (!file.open(path)) {
+        error = "can't open " + path;
+        return false;
+    }
+
+    Header h;
+    if (file.size() < sizeof(Header)) {
+        error = "truncated header";
+        return false;
+    }
+    memcpy(&h, file.data(), sizeof(h));
+    if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.headerSize != sizeof(Header)) {
+        error = "not a cloth asset";
+        return false;
+    }
+    if (h.version != VERSION) {
+        error = "version " + std::to_string(h.version) + ", expected " + std::to_string(VERSION);
+        return false;
+    }
+    for (int i = 0; i < SECTIONS; i++) {
+        if (h.offset[i] % ALIGNMENT != 0 || h.offset[i] > file.size() || sectionSize(h, i) > file.size() - h.offset[i]) {
+            error = "truncated data";
+            return false;
+        }
+    }
+
+    if (!source.empty()) {
+        uint64_t size;
+        int64_t time;
+        // Without a stamp to compare, the asset can't be trusted either
+        if (!sourceStamp(source, size, time)) {
+            error = "can't stat " + source;
+            return false;
+        }
+        if (size != h.sourceSize || time != h.sourceTime) {
+            error = "older than " + source;
+            return false;
+        }
+    }
+
+    const char* base = file.data();
+    const Vec3* position = (const Vec3*)(base + h.offset[POSITION]);
+    const Vec2* texCoord = (const Vec2*)(base + h.offset[TEXCOORD]);
+    const uint32_t* faces = (const uint32_t*)(base + h.offset[FACES]);
+    const uint32_t* node1 = (const uint32_t*)(base + h.offset[NODE1]);
+    const uint32_t* node2 = (const uint32_t*)(base + h.offset[NODE2]);
+    const uint32_t* pinned = (const uint32_t*)(base + h.offset[PINNED]);
+    for (uint32_t t = 0; t < 3 * h.triangleCount; t++) {
+        if (faces[t] >= h.nodeCount) {
+            error = "triangle node out of range";
+            return false;
+        }
+    }
+    for (uint32_t s = 0; s < h.springCount; s++) {
+        if (node1[s] >= h.nodeCount || node2[s] >= h.nodeCount) {
+            error = "spring node out of range";
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < h.pinCount; i++) {
+        if (pinned[i] >= h.nodeCount) {
+            error = "pinned node out of range";
+            return false;
+        }
+    }
+
+    // Streams straight from the view, the rest as ParticleData::set leaves it
+    ParticleData& p = cloth.particles;
+    p.resize(h.nodeCount);
+#pragma omp parallel for
+    for (int n = 0; n < (int)h.nodeCount; n++)
+        p.set(n, position[n], texCoord[n]);
+    if (h.nodeCount > 0)
+        memcpy(&p.tangent[0].x, base + h.offset[TANGENT], sectionSize(h, TANGENT));
+
+    cloth.faces.assign(faces, faces + 3 * h.triangleCount);
+
+    SpringData& s = cloth.springs;
+    s.resize(h.springCount);
+    memcpy(s.node1.data(), node1, sectionSize(h, NODE1));
+    memcpy(s.node2.data(), node2, sectionSize(h, NODE2));
+    memcpy(s.restLen.data(), base + h.offset[REST_LENGTH], sectionSize(h, REST_LENGTH));
+    memcpy(s.type.data(), base + h.offset[TYPE], sectionSize(h, TYPE));
+    std::fill(s.hookCoef.begin(), s.hookCoef.end(), 0.0);
+
+    cloth.pinnedNodes.assign(pinned, pinned + h.pinCount);
+    for (unsigned int n : cloth.pinnedNodes)
+        p.isFixed[n] = 1;
+
+    cloth.nodesPerRow = h.nodesPerRow;
+    cloth.nodesPerCol = h.nodesPerCol;
+    cloth.nodesDensity = h.nodesDensity;
+    cloth.clothPos = Vec3(h.clothPos[0], h.clothPos[1], h.clothPos[2]);
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef CLOTH_ASSET_H
+#define CLOTH_ASSET_H
+
+#include <string>
+#include <cstdint>
+
+class ClothData;
+
+// Precompiled cloth (.clothbin): a built ClothData, before any node
+// reordering, stored as the raw simulation streams so loading is a mapped
+// bulk copy with nothing to parse or derive. Little-endian, a fixed header
+// followed by 16 byte aligned sections:
+//   position, texCoord, tangent   per node (doubles)
+//   faces                         3 nodes per triangle
+//   node1, node2, restLen, type   per spring (integrators set coefficients)
+//   pinnedNodes
+// The header keeps the size and modification time of the source mesh, so a
+// stale asset is ignored rather than loaded.
+class ClothAsset {
+public:
+    enum { VERSION = 1 };
+
+    static bool save(const ClothData& cloth, const std::string& path, const std::string& source, std::string& error);
+
+    // Fills an empty ClothData. With a source, fails if the asset wasn't
+    // built from that file as it is now, or if the file can't be stat'ed.
+    // cloth is left untouched on failure.
+    static bool load(const std::string& path, const std::string& source, ClothData& cloth, std::string& error);
+
+    // "Mesh/tshirt.obj" -> "Mesh/tshirt.clothbin"
+    static std::string pathFor(const std::string& source);
+
+private:
+    static bool sourceStamp(const std::string& source, uint64_t& size, int64_t& time);
+};
+
+#endif
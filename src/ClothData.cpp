@@ -1,134 +1,151 @@
 #include <omp.h>
 #include <string>
 #include <iostream>
-#include <fstream>
 #include <sstream>
-#include <map>
+#include <algorithm>
+#include <cmath>
 
 #include "ClothData.h"
-#include "Node.h"
-#include "Spring.h"
+#include "ParticleData.h"
+#include "SpringData.h"
+#include "ObjLoader.h"
+#include "ClothAsset.h"
 #include "Vectors.h"
 
 ClothData::ClothData() {};
 
-ClothData::ClothData(const std::string& shape) {
-    if (shape == "grid")
-        BuildGrid();
-    if (shape == "tshirt")
-		BuildFromObj("Mesh/tshirt.obj"); 
+ClothData::ClothData(const std::string& shape, NodeOrdering::Type ordering) {
+    if (shape == "grid" || shape.compare(0, 5, "grid:") == 0)
+        BuildGrid(GridParams::fromShape(shape));
+    if (shape == "tshirt") {
+        // Precompiled asset when it is up to date, see ClothAssetConverter
+        if (!BuildFromAsset(ClothAsset::pathFor("Mesh/tshirt.obj"), "Mesh/tshirt.obj"))
+            BuildFromObj("Mesh/tshirt.obj");
+    }
 
+    reorderNodes(ordering);
 }
 
-void ClothData::BuildGrid() {
-    clothPos = Vec3(0.0, 7.0, 0.0);
-    nodesPerRow = 40;
-    nodesPerCol = 40;
-    nodesDensity = 4;
+GridParams::GridParams()
+    : nodesPerRow(40), nodesPerCol(40), width(9.75), height(9.75),
+    origin(0.0, 7.0, 0.0), pins(PIN_CORNERS), stretch(true), shear(true), bending(true) {}
+
+GridParams GridParams::fromShape(const std::string& shape) {
+    // Same physical size at any resolution
+    GridParams params;
+    if (shape.size() <= 5)
+        return params;
+
+    std::istringstream ss(shape.substr(5));
+    int rows = 0, cols = 0;
+    char sep = 0;
+    ss >> rows;
+    if (ss >> sep)
+        ss >> cols;
+    else
+        cols = rows;
+
+    if (rows < 2 || cols < 2 || (sep != 0 && sep != 'x')) {
+        std::cout << "ERROR::GridParams : Unsupported grid shape: " << shape << std::endl;
+        return params;
+    }
+    params.nodesPerRow = rows;
+    params.nodesPerCol = cols;
+    return params;
+}
 
-    // Nodes
-    for (int i = 0; i < nodesPerRow; ++i) {
-        for (int j = 0; j < nodesPerCol; ++j) {
+void ClothData::BuildGrid(const GridParams& params) {
+    const int R = params.nodesPerRow;
+    const int C = params.nodesPerCol;
+    clothPos = params.origin;
+    nodesPerRow = R;
+    nodesPerCol = C;
+    nodesDensity = (int)std::lround((R - 1) / params.width);
+
+    // Nodes, row by row
+    particles.resize((size_t)R * C);
+#pragma omp parallel for
+    for (int y = 0; y < C; ++y) {
+        for (int x = 0; x < R; ++x) {
 			// texture coordinates
-            float u = (float)j / (nodesPerCol - 1); 
-            float v = (float)i / (nodesPerRow - 1);
-            
-            Vec2 uv = Vec2(u,v);
-            unsigned int id = i * nodesPerRow + j;
-            Vec3 pos = Vec3((double)j / nodesDensity, 0, -((double)i / nodesDensity));
-
-            nodes.push_back(new Node(id,pos,uv));
+            float u = (float)x / (R - 1);
+            float v = (float)y / (C - 1);
+
+            Vec3 pos = Vec3((double)x * params.width / (R - 1), 0, -((double)y * params.height / (C - 1)));
+            unsigned int n = getNode(x, y);
+            particles.set(n, pos, Vec2(u, v));
+
+            // u grows along +x on a flat grid, what computeTangent would
+            // find without its uv determinant cutoff at high resolutions
+            particles.tangent[n] = Vec3(1.0, 0.0, 0.0);
         }
     }
 
-    // Springs
-    //0: quad springs
-    //1: first diagonal spring (/)
-    //2: second diagonal spring (/)
-    //3: quad springs
-    for (int i = 0; i < nodesPerRow; i++) {
-        for (int j = 0; j < nodesPerCol; j++) {
-			// Quad springs
-            if (i < nodesPerRow - 1) springs.push_back(new Spring(0, getNode(i, j), getNode(i + 1, j), 0.0f));
-            if (j < nodesPerCol - 1) springs.push_back(new Spring(0, getNode(i, j), getNode(i, j + 1), 0.0f));
-            
-			// Diagonal springs
-            if (i < nodesPerRow - 1 && j < nodesPerCol - 1) {
-                springs.push_back(new Spring(1, getNode(i + 1, j), getNode(i, j + 1), 0.0f));
-                springs.push_back(new Spring(2, getNode(i, j), getNode(i + 1, j + 1), 0.0f));
+    // Springs, column by column: every node (x, y) adds, as far as they fit
+    //0: quad springs to (x + 1, y) and (x, y + 1)
+    //1: first diagonal spring (x + 1, y) - (x, y + 1)
+    //2: second diagonal spring to (x + 1, y + 1)
+    //3: quad springs to (x + 2, y) and (x, y + 2)
+    // The exact count of every column gives its first spring, so columns
+    // fill in parallel and the order does not depend on the thread count.
+    auto columnSprings = [&](int x) {
+        size_t count = 0;
+        if (params.stretch) count += (x < R - 1 ? C : 0) + (C - 1);
+        if (params.shear) count += (x < R - 1 ? 2 * (C - 1) : 0);
+        if (params.bending) count += (x < R - 2 ? C : 0) + std::max(C - 2, 0);
+        return count;
+    };
+    std::vector<size_t> first(R + 1, 0);
+    for (int x = 0; x < R; ++x)
+        first[x + 1] = first[x] + columnSprings(x);
+
+    springs.resize(first[R]);
+#pragma omp parallel for
+    for (int x = 0; x < R; ++x) {
+        unsigned int s = (unsigned int)first[x];
+        for (int y = 0; y < C; ++y) {
+            if (params.stretch) {
+                if (x < R - 1) springs.set(s++, 0, particles, getNode(x, y), getNode(x + 1, y), 0.0f);
+                if (y < C - 1) springs.set(s++, 0, particles, getNode(x, y), getNode(x, y + 1), 0.0f);
+            }
+            if (params.shear && x < R - 1 && y < C - 1) {
+                springs.set(s++, 1, particles, getNode(x + 1, y), getNode(x, y + 1), 0.0f);
+                springs.set(s++, 2, particles, getNode(x, y), getNode(x + 1, y + 1), 0.0f);
+            }
+            if (params.bending) {
+                if (x < R - 2) springs.set(s++, 3, particles, getNode(x, y), getNode(x + 2, y), 0.0f);
+                if (y < C - 2) springs.set(s++, 3, particles, getNode(x, y), getNode(x, y + 2), 0.0f);
             }
-
-			// Additional quad springs
-            if (i < nodesPerRow - 2) springs.push_back(new Spring(3, getNode(i, j), getNode(i + 2, j), 0.0f));
-            if (j < nodesPerCol - 2) springs.push_back(new Spring(3, getNode(i, j), getNode(i, j + 2), 0.0f));
         }
     }
 
-    // Triangle faces
-    for (int i = 0; i < nodesPerRow - 1; ++i) {
-        for (int j = 0; j < nodesPerCol - 1; ++j) {
+    // Triangle faces, two per quad
+    faces.resize((size_t)(R - 1) * (C - 1) * 6);
+#pragma omp parallel for
+    for (int x = 0; x < R - 1; ++x) {
+        for (int y = 0; y < C - 1; ++y) {
+            unsigned int* f = &faces[((size_t)x * (C - 1) + y) * 6];
             // Left upper triangle
-            faces.push_back(getNode(i + 1, j));
-            faces.push_back(getNode(i, j));
-            faces.push_back(getNode(i, j + 1));
+            f[0] = getNode(x + 1, y);
+            f[1] = getNode(x, y);
+            f[2] = getNode(x, y + 1);
             // Right bottom triangle
-            faces.push_back(getNode(i + 1, j + 1));
-            faces.push_back(getNode(i + 1, j));
-            faces.push_back(getNode(i, j + 1));
+            f[3] = getNode(x + 1, y + 1);
+            f[4] = getNode(x + 1, y);
+            f[5] = getNode(x, y + 1);
         }
     }
 
-    // === Tangent calculation ===
-    for (size_t i = 0; i < faces.size(); i += 3) {
-        Node* n0 = faces[i];
-        Node* n1 = faces[i + 1];
-        Node* n2 = faces[i + 2];
-
-        Vec3 p0 = n0->position;
-        Vec3 p1 = n1->position;
-        Vec3 p2 = n2->position;
-
-        Vec2 uv0 = n0->texCoord;
-        Vec2 uv1 = n1->texCoord;
-        Vec2 uv2 = n2->texCoord;
-
-        Vec3 edge1 = p1 - p0;
-        Vec3 edge2 = p2 - p0;
-        Vec2 deltaUV1 = uv1 - uv0;
-        Vec2 deltaUV2 = uv2 - uv0;
-
-        float f = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
-        if (fabs(f) < 1e-6f) f = 1.0f;
-        else f = 1.0f / f;
-
-        Vec3 tangent;
-        tangent.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-        tangent.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-        tangent.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-
-        for (int j = 0; j < 3; ++j) {
-            Node* n = faces[i + j];
-            n->tangentSum += tangent;
-            n->tangentCount++;
-        }
+    if (params.pins == GridParams::PIN_CORNERS) {
+        pinnedNodes.push_back(getNode(0, 0));
+        pinnedNodes.push_back(getNode(R - 1, 0));
     }
-
-    for (Node* node : nodes) {
-        if (node->tangentCount > 0) {
-            node->tangent = node->tangentSum / node->tangentCount;
-            node->tangent.normalize();
-        }
-        else {
-            node->tangent = Vec3(1.0f, 0.0f, 0.0f); // fallback
-        }
+    else if (params.pins == GridParams::PIN_TOP_EDGE) {
+        for (int x = 0; x < R; ++x)
+            pinnedNodes.push_back(getNode(x, 0));
     }
-
-    nodes[0]->isFixed = true;
-    nodes[nodesPerRow - 1]->isFixed = true;
-
-    std::cout << "Grid: " << std::endl;
-    std::cout << "- nodes: " << nodes.size() << std::endl;
-    std::cout << "- springs: " << springs.size() << std::endl;
+    for (unsigned int n : pinnedNodes)
+        particles.isFixed[n] = 1;
 }
 
 //void ClothData::BuildFromObj(const std::string& path) {
@@ -203,86 +220,106 @@ void ClothData::BuildFromObj(const std::string& path) {
     nodesPerCol = 0;
     nodesDensity = 0;
 
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        std::cerr << "Errore apertura file: " << path << std::endl;
+    ObjMesh mesh;
+    std::string error;
+    if (!ObjLoader::load(path, mesh, error)) {
+        std::cerr << "Errore lettura file: " << path << " (" << error << ")" << std::endl;
         return;
     }
 
-    std::vector<Vec3> positions;
-    std::vector<Vec2> texcoords;
-    std::vector<std::vector<std::pair<int, int>>> faceIndices; // 3 faces 
+    // One particle per welded corner, one stretch spring per mesh edge
+    particles.resize(mesh.nodeCount());
+#pragma omp parallel for
+    for (int n = 0; n < (int)mesh.nodeCount(); n++)
+        particles.set(n, mesh.position[n], mesh.texCoord[n]);
 
-    std::string line;
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string prefix;
-        ss >> prefix;
+    faces.swap(mesh.triangles);
 
-        if (prefix == "v") {
-            float x, y, z;
-            ss >> x >> y >> z;
-            positions.emplace_back(x, y, z);
-        }
-        else if (prefix == "vt") {
-            float u, v;
-            ss >> u >> v;
-            texcoords.emplace_back(u, v);
-        }
-        else if (prefix == "f") { // f v1/vt1 v2/vt2 v3/vt3
-			std::vector<std::pair<int, int>> point; // pair<vertex index, texcoord index>
-            std::string token;
-            while (ss >> token) {
-                std::stringstream fs(token);
-                std::string vStr, vtStr;
-                std::getline(fs, vStr, '/');
-                std::getline(fs, vtStr, '/');
-
-                int vIdx = std::stoi(vStr) - 1;
-                int vtIdx = vtStr.empty() ? -1 : std::stoi(vtStr) - 1;
-                point.emplace_back(vIdx, vtIdx);
-            }
-            if (point.size() == 3) {
-                faceIndices.push_back(point);
-            }
-        }
+    springs.resize(mesh.edgeCount());
+#pragma omp parallel for
+    for (int e = 0; e < (int)mesh.edgeCount(); e++)
+        springs.set(e, 0, particles, mesh.edges[2 * e], mesh.edges[2 * e + 1], 0.0f);
+
+    computeTangent();
+
+    if (particles.size() > 0) pinnedNodes.push_back(0);
+    if (particles.size() > 10) pinnedNodes.push_back(10);
+    for (unsigned int n : pinnedNodes)
+        particles.isFixed[n] = 1;
+
+    std::cout << "Tshirt OBJ Loaded:" << std::endl;
+    std::cout << "- nodes: " << particles.size() << std::endl;
+    std::cout << "- springs: " << springs.size() << std::endl;
+}
+
+bool ClothData::BuildFromAsset(const std::string& path, const std::string& source) {
+    std::string error;
+    if (!ClothAsset::load(path, source, *this, error)) {
+        std::cout << "Cloth asset skipped: " << path << " (" << error << ")" << std::endl;
+        return false;
     }
 
-    // Map to ensure unique vertex per (position, texcoord)
-    std::map<std::pair<int, int>, Node*> uniqueNodes;
+    std::cout << "Cloth asset Loaded:" << std::endl;
+    std::cout << "- nodes: " << particles.size() << std::endl;
+    std::cout << "- springs: " << springs.size() << std::endl;
+    return true;
+}
 
-    for (const auto& face : faceIndices) {
-        Node* tri[3];
-        for (int i = 0; i < 3; ++i) {
-            auto key = face[i];
-            if (uniqueNodes.count(key) == 0) {  // Determine whether a point has been instantiated
-                Vec3 pos = positions[key.first];
-                Node* node = new Node(pos);
-				if (key.second >= 0 && key.second < texcoords.size()) { // Determine whether the texture coordinates are valid
-                    node->texCoord = texcoords[key.second];
-                }
-                uniqueNodes[key] = node;
-                nodes.push_back(node);
-            }
-            tri[i] = uniqueNodes[key];
-        }
+void ClothData::reorderNodes(NodeOrdering::Type ordering) {
+    if (ordering == NodeOrdering::NONE || particles.size() == 0)
+        return;
 
-        faces.push_back(tri[0]);
-        faces.push_back(tri[1]);
-        faces.push_back(tri[2]);
+    size_t factorBefore = NodeOrdering::factorNonZeros(springs, particles.size());
+    unsigned int bandBefore = NodeOrdering::bandwidth(springs);
+
+    std::vector<unsigned int> order = NodeOrdering::compute(ordering, particles, springs);
+    std::vector<unsigned int> newIndex(order.size());
+    for (unsigned int i = 0; i < order.size(); i++)
+        newIndex[order[i]] = i;
+
+    particles.permute(order);
+    springs.renumberNodes(newIndex);
+    for (unsigned int& n : pinnedNodes)
+        n = newIndex[n];
+
+    // Triangles sorted by their lowest node, so rendering walks memory in order
+    std::vector<unsigned int> tri(faces.size() / 3);
+    for (unsigned int t = 0; t < tri.size(); t++)
+        tri[t] = t;
+    for (unsigned int& n : faces)
+        n = newIndex[n];
+    auto lowest = [&](unsigned int t) {
+        return std::min(faces[t * 3], std::min(faces[t * 3 + 1], faces[t * 3 + 2]));
+    };
+    std::stable_sort(tri.begin(), tri.end(), [&](unsigned int a, unsigned int b) { return lowest(a) < lowest(b); });
+    std::vector<unsigned int> sorted(faces.size());
+    for (size_t t = 0; t < tri.size(); t++) {
+        sorted[t * 3 + 0] = faces[tri[t] * 3 + 0];
+        sorted[t * 3 + 1] = faces[tri[t] * 3 + 1];
+        sorted[t * 3 + 2] = faces[tri[t] * 3 + 2];
+    }
+    faces.swap(sorted);
+
+    std::cout << "- ordering: " << NodeOrdering::name(ordering) << std::endl;
+    std::cout << "- bandwidth: " << bandBefore << " -> " << NodeOrdering::bandwidth(springs) << std::endl;
+    std::cout << "- factor nonzeros: " << factorBefore << " -> " << NodeOrdering::factorNonZeros(springs, particles.size()) << std::endl;
+}
+
+void ClothData::computeTangent() {
+    std::vector<Vec3> tangentSum(particles.size());
+    std::vector<int> tangentCount(particles.size(), 0);
 
-        springs.push_back(new Spring(0, tri[0], tri[1], 0.0f));
-        springs.push_back(new Spring(0, tri[1], tri[2], 0.0f));
-        springs.push_back(new Spring(0, tri[2], tri[0], 0.0f));
+    for (size_t t = 0; t < faces.size(); t += 3) {
+        unsigned int tri[3] = { faces[t], faces[t + 1], faces[t + 2] };
 
 		// calculate tangent
-        Vec3 p0 = tri[0]->position;
-        Vec3 p1 = tri[1]->position;
-        Vec3 p2 = tri[2]->position;
+        Vec3 p0 = particles.position[tri[0]];
+        Vec3 p1 = particles.position[tri[1]];
+        Vec3 p2 = particles.position[tri[2]];
 
-        Vec2 uv0 = tri[0]->texCoord;
-        Vec2 uv1 = tri[1]->texCoord;
-        Vec2 uv2 = tri[2]->texCoord;
+        Vec2 uv0 = particles.texCoord[tri[0]];
+        Vec2 uv1 = particles.texCoord[tri[1]];
+        Vec2 uv2 = particles.texCoord[tri[2]];
 
         Vec3 edge1 = p1 - p0;
         Vec3 edge2 = p2 - p0;
@@ -311,45 +348,40 @@ void ClothData::BuildFromObj(const std::string& path) {
         tangent.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
 
         for (int i = 0; i < 3; ++i) {
-            tri[i]->tangentSum += tangent;
-            tri[i]->tangentCount++;
+            tangentSum[tri[i]] += tangent;
+            tangentCount[tri[i]]++;
         }
 
     }
 
 	// Normalize tangents
-    for (auto node : nodes) {
-        if (node->tangentCount > 0) {
-            node->tangent = node->tangentSum / node->tangentCount;
-            node->tangent.normalize();
+    for (size_t i = 0; i < particles.size(); ++i) {
+        if (tangentCount[i] > 0) {
+            particles.tangent[i] = tangentSum[i] / tangentCount[i];
+            particles.tangent[i].normalize();
         }
         else {
-            node->tangent = Vec3(1.0f, 0.0f, 0.0f); // fallback
+            particles.tangent[i] = Vec3(1.0f, 0.0f, 0.0f); // fallback
         }
     }
-
-    if (!nodes.empty()) nodes[0]->isFixed = true;
-    if (nodes.size() > 10) nodes[10]->isFixed = true;
-
-    std::cout << "Tshirt OBJ Loaded:" << std::endl;
-    std::cout << "- nodes: " << nodes.size() << std::endl;
-    std::cout << "- springs: " << springs.size() << std::endl;
 }
 
-Node* ClothData::getNode(int x, int y) const {
-    return nodes[y * nodesPerRow + x];
+unsigned int ClothData::getNode(int x, int y) const {
+    return y * nodesPerRow + x;
 }
 
-Vec3 ClothData::getWorldPos(Node* n) const {
-    return Vec3(clothPos.x + n->position.x, clothPos.y + n->position.y, clothPos.z + n->position.z);
+Vec3 ClothData::getWorldPos(unsigned int n) const {
+    const Vec3& p = particles.position[n];
+    return Vec3(clothPos.x + p.x, clothPos.y + p.y, clothPos.z + p.z);
 }
 
-void ClothData::setWorldPos(Node* n, Vec3 pos) const {
-    n->position = pos - Vec3(0.0, 7.0, 0.0);
+void ClothData::setWorldPos(unsigned int n, Vec3 pos) {
+    particles.position[n] = pos - clothPos;
 }
 
-Vec3 ClothData::computeFaceNormal(Node* n1, Node* n2, Node* n3) {
-    return Vec3::cross(n2->position - n1->position, n3->position - n1->position);
+Vec3 ClothData::computeFaceNormal(unsigned int n1, unsigned int n2, unsigned int n3) {
+    Vec3 p1 = particles.position[n1];
+    return Vec3::cross(Vec3(particles.position[n2]) - p1, Vec3(particles.position[n3]) - p1);
 }
 
 void ClothData::computeNormal()
@@ -358,36 +390,30 @@ void ClothData::computeNormal()
     Vec3 normal(0.0, 0.0, 0.0);
 
 #pragma omp parallel for
-    for (int i = 0; i < nodes.size(); i++) {
-        nodes[i]->normal = normal;
+    for (int i = 0; i < particles.size(); i++) {
+        particles.normal[i] = normal;
     }
     /** Compute normal of each face **/
     for (int i = 0; i < faces.size() / 3; i++) { // 3 nodes in each face
-        Node* n1 = faces[3 * i + 0];
-        Node* n2 = faces[3 * i + 1];
-        Node* n3 = faces[3 * i + 2];
+        unsigned int n1 = faces[3 * i + 0];
+        unsigned int n2 = faces[3 * i + 1];
+        unsigned int n3 = faces[3 * i + 2];
 
         // Face normal
         normal = computeFaceNormal(n1, n2, n3);
         // Add all face normal
-        n1->normal += normal;
-        n2->normal += normal;
-        n3->normal += normal;
+        particles.normal[n1] += normal;
+        particles.normal[n2] += normal;
+        particles.normal[n3] += normal;
     }
     #pragma omp parallel for
-    for (int i = 0; i < nodes.size(); i++) {
-        nodes[i]->normal.normalize();
+    for (int i = 0; i < particles.size(); i++) {
+        particles.normal[i].normalize();
     }
 }
 
 ClothData::~ClothData() {
-	for (Node* node : nodes) {
-		delete node;
-	}
-	for (Spring* spring : springs) {
-		delete spring;
-	}
-	nodes.clear();
+	particles.clear();
 	springs.clear();
 	faces.clear();
 }
\ No newline at end of file
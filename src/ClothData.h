@@ -3,14 +3,39 @@
 
 #include <vector>
 #include <string>
-#include "Node.h"
-#include "Spring.h"
+#include "ParticleData.h"
+#include "SpringData.h"
+#include "NodeOrdering.h"
+
+// Procedural grid cloth. Node (x, y) is y * nodesPerRow + x and starts at
+// (x * width / (nodesPerRow - 1), 0, -y * height / (nodesPerCol - 1)).
+struct GridParams {
+    enum Pins {
+        PIN_NONE,
+        PIN_CORNERS, // (0, 0) and (nodesPerRow - 1, 0)
+        PIN_TOP_EDGE // Every node with y = 0
+    };
+
+    int nodesPerRow;
+    int nodesPerCol;
+    double width;
+    double height;
+    Vec3 origin; // clothPos
+    Pins pins;
+    bool stretch; // Spring categories: 0
+    bool shear;   // 1 and 2
+    bool bending; // 3
+
+    GridParams();
+    static GridParams fromShape(const std::string& shape); // "grid", "grid:N" or "grid:NxM"
+};
 
 class ClothData {
 public:
-    std::vector<Node*> nodes;
-    std::vector<Spring*> springs;
-    std::vector<Node*> faces;
+    ParticleData particles;
+    SpringData springs;
+    std::vector<unsigned int> faces; // 3 particle indices per triangle
+    std::vector<unsigned int> pinnedNodes; // Pinned at build and on restart
 
     int nodesPerRow;
 	int nodesPerCol;
@@ -18,18 +43,21 @@ public:
     Vec3 clothPos;
 
     ClothData();
-    ClothData(const std::string& shape);
-    void BuildGrid();
+    ClothData(const std::string& shape, NodeOrdering::Type ordering = NodeOrdering::NONE);
+    void BuildGrid(const GridParams& params = GridParams());
     void BuildFromObj(const std::string& path);
+    bool BuildFromAsset(const std::string& path, const std::string& source = ""); // False if missing, invalid or older than source
+    void reorderNodes(NodeOrdering::Type ordering);
 
     void computeNormal();
-    Vec3 computeFaceNormal(Node* n1, Node* n2, Node* n3);
+    void computeTangent();
+    Vec3 computeFaceNormal(unsigned int n1, unsigned int n2, unsigned int n3);
 
     //void pin();
     //void unpin();
-    Node* getNode(int x, int y) const;
-    Vec3 getWorldPos(Node* n) const;
-    void setWorldPos(Node* n, Vec3 pos) const;
+    unsigned int getNode(int x, int y) const; // Grid build order, not valid after reorderNodes
+    Vec3 getWorldPos(unsigned int n) const;
+    void setWorldPos(unsigned int n, Vec3 pos);
 
     ~ClothData();
 };
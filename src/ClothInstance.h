@@ -5,7 +5,7 @@
 #include <vector>
 #include "ClothData.h"
 #include "IClothSimulator.h"
-#include "Icollider.h"
+#include "ICollider.h"
 #include <memory>
 
 class ClothInstance {
@@ -17,7 +17,7 @@ public:
     };
     DrawModeEnum drawMode = DRAW_FACES;
 
-    static ClothInstance* create(const std::string& shape, const std::string& method);
+    static ClothInstance* create(const std::string& shape, const std::string& method, NodeOrdering::Type ordering = NodeOrdering::NONE);
 
     void update();
     void unpin();
@@ -27,6 +27,7 @@ public:
     IClothSimulator* getSimulator();
     std::vector<ICollider*> getColliders();
     void addCollider(ICollider* col);
+    void setStiffness(double stretching, double shear, double bending);
 
 private:
     ClothInstance(ClothData* data, IClothSimulator* simulator);
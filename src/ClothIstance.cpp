@@ -7,6 +7,8 @@
 #include "SymplecticEulerIntegrator.h"
 #include "PositionBasedIntegrator.h"
 #include "ProjectiveDynamicsIntegrator.h"
+#include "LBFGSIntegrator.h"
+#include "VertexBlockDescentIntegrator.h"
 #include "ICollider.h"
 #include "SphereCollider.h"
 #include "GroundCollider.h"
@@ -16,8 +18,8 @@ ClothInstance::ClothInstance(ClothData* d, IClothSimulator* s)
     : data(d), simulator(s) {
 }
 
-ClothInstance* ClothInstance::create(const std::string& shape, const std::string& method) {
-    ClothData* data = new ClothData(shape);
+ClothInstance* ClothInstance::create(const std::string& shape, const std::string& method, NodeOrdering::Type ordering) {
+    ClothData* data = new ClothData(shape, ordering);
     IClothSimulator* sim = nullptr;
 
     if (method == "ExplicitEuler") {
@@ -32,12 +34,33 @@ ClothInstance* ClothInstance::create(const std::string& shape, const std::string
 	else if (method == "XPBD") {
 		sim = new PositionBasedIntegrator(data, "XPBD");
 	}
+	else if (method == "JacobiPBD") {
+		sim = new PositionBasedIntegrator(data, "JacobiPBD");
+	}
+	else if (method == "ChebyshevPBD") {
+		sim = new PositionBasedIntegrator(data, "ChebyshevPBD");
+	}
 	else if (method == "ProjectiveDynamics") {
 		sim = new ProjectiveDynamicsIntegrator(data);
 	}
+	else if (method == "ChebyshevPD") {
+		sim = new ProjectiveDynamicsIntegrator(data, "ChebyshevPD");
+	}
+	else if (method == "AndersonPD") {
+		sim = new ProjectiveDynamicsIntegrator(data, "AndersonPD");
+	}
 	else if (method == "ImplicitNewton") {
 		sim = new ImplicitNewtonIntegrator(data);
 	}
+	else if (method == "NewtonPCG") {
+		sim = new ImplicitNewtonIntegrator(data, "NewtonPCG");
+	}
+	else if (method == "LBFGS") {
+		sim = new LBFGSIntegrator(data);
+	}
+	else if (method == "VBD") {
+		sim = new VertexBlockDescentIntegrator(data);
+	}
 	else {
 		std::cout << "ERROR::ClothInstance : Unsupported simulation method: " << method << std::endl;
 		delete data;
@@ -78,20 +101,23 @@ void ClothInstance::addCollider(ICollider* col) {
 	simulator->addCollider(col);
 }
 
+void ClothInstance::setStiffness(double stretching, double shear, double bending) {
+	simulator->setStiffness(stretching, shear, bending);
+}
+
 void ClothInstance::restart() {
-	for (int i = 0; i < data->nodes.size(); i++) {
-		data->nodes[i]->normal.setZeroVec();
-		data->nodes[i]->position = data->nodes[i]->initial_position;
-		data->nodes[i]->old_position = data->nodes[i]->initial_position;
-		data->nodes[i]->velocity.setZeroVec();
-		data->nodes[i]->prec_velocity.setZeroVec();
-		data->nodes[i]->acceleration.setZeroVec();
-		data->nodes[i]->force.setZeroVec();
+	ParticleData& p = data->particles;
+	for (int i = 0; i < p.size(); i++) {
+		p.normal[i].setZeroVec();
+		p.position[i] = p.initial_position[i];
+		p.old_position[i] = p.initial_position[i];
+		p.velocity[i].setZeroVec();
+		p.force[i].setZeroVec();
+	}
+	for (unsigned int n : data->pinnedNodes) {
+		p.isFixed[n] = 1;
+		p.mass[n] = std::numeric_limits<double>::infinity();
+		p.invMass[n] = 0.0;
 	}
-	data->nodes[0]->isFixed = true;
-	data->nodes[data->nodesPerRow - 1]->isFixed = true;
-	data->nodes[0]->mass = std::numeric_limits<double>::infinity();
-	data->nodes[0]->w = 0.0;
-	data->nodes[data->nodesPerRow - 1]->mass = std::numeric_limits<double>::infinity();
-	data->nodes[data->nodesPerRow - 1]->w = 0.0;
+	simulator->restart();
 }
\ No newline at end of file
@@ -3,12 +3,15 @@
 
 #include <iostream>
 #include <vector>
+#include <chrono>
+#include <cstring>
 #include "Program.h"
 #include "shader/shader_m.h"
 #include "image/stb_image.h"
 #include "Vertex.h"
 #include "ClothData.h"
 #include "ClothInstance.h"
+#include "StreamConvert.h"
 #include "Globals.h"
 #include "Material.h"
 #include "Ground.h"
@@ -17,6 +20,13 @@
 #include "Capsule.h"
 #include "SweptSphere.h"
 #include "SweptSphereTri.h"
+#include "SphereCollider.h"
+#include "AABBCollider.h"
+#include "CapsuleCollider.h"
+#include "SweptSphereCollider.h"
+#include "SweptSphereTriCollider.h"
+#include "GroundCollider.h"
+#include "SphereMeshesCollider.h"
 
 
 struct Texture {
@@ -29,14 +39,42 @@ struct ClothRender {
     const ClothInstance* clothInstance;
     const ClothData* cloth;
     int nodeCount;
-
-    glm::vec3* vboPos;
-    glm::vec2* vboTex;
-    glm::vec3* vboNor;
-    glm::vec3* vboTan;
+    int indexCount;
+
+    // Positions and normals are streamed every frame. With buffer storage
+    // (GL 4.4) each stream is a persistently mapped, coherent buffer holding
+    // STREAM_REGIONS copies: the frame writes one region, converting straight
+    // into mapped memory, while the GPU may still draw from the others. A
+    // fence per region keeps a region from being rewritten before the draws
+    // reading it are done. Otherwise one region, converted to staging arrays
+    // and uploaded with glBufferSubData: always when persistent streams are
+    // turned off (to exercise that path on new drivers) or can't be mapped.
+    enum { STREAM_REGIONS = 3 };
+    bool persistent;
+    int regionCount;
+    int region;
+    float* mappedPos;
+    float* mappedNor;
+    std::vector<float> stagingPos;
+    std::vector<float> stagingNor;
+    GLsync fences[STREAM_REGIONS];
+
+    // Debug builds read back the first upload of every region and compare it
+    // with the floats written
+    int regionsChecked;
+    bool checkFailed;
+
+    // CPU time of the last flushes (ms, smoothed): fence wait, double to
+    // float conversion, glBufferSubData
+    struct StreamStats {
+        double wait;
+        double convert;
+        double upload;
+    } stats;
 
     GLuint vaoID;
     GLuint vboIDs[4]; // pos, tex, norm, tan
+    GLuint eboID;     // ClothData::faces
 
     Material material;
     Shader shader;
@@ -44,7 +82,7 @@ struct ClothRender {
     std::string dir;
     std::string basename;
 
-    ClothRender(ClothInstance* clothI, std::string dir, std::string basename)
+    ClothRender(ClothInstance* clothI, std::string dir, std::string basename, bool allowPersistent = true)
         : shader("Shaders/PBR.vs", "Shaders/PBR.fs"),
           dir(dir),
           basename(basename){
@@ -52,72 +90,169 @@ struct ClothRender {
         this->cloth = clothI->getData();
         this->material.LoadFromDirectory(dir, basename);
 
-        nodeCount = (int)cloth->faces.size();
-        if (nodeCount <= 0) {
+        nodeCount = (int)cloth->particles.size();
+        indexCount = (int)cloth->faces.size();
+        if (indexCount <= 0) {
             std::cerr << "ERROR::ClothRender : No nodes." << std::endl;
             exit(-1);
         }
 
-        vboPos = new glm::vec3[nodeCount];
-        vboTex = new glm::vec2[nodeCount];
-        vboNor = new glm::vec3[nodeCount];
-        vboTan = new glm::vec3[nodeCount];
-
-        for (int i = 0; i < nodeCount; ++i) {
-            Node* n = cloth->faces[i];
-            vboPos[i] = glm::vec3(n->position.x, n->position.y, n->position.z);
-            vboTex[i] = glm::vec2(n->texCoord.x, n->texCoord.y);
-            vboNor[i] = glm::vec3(n->normal.x, n->normal.y, n->normal.z);
-            vboTan[i] = glm::vec3(n->tangent.x, n->tangent.y, n->tangent.z);
+        // One vertex per node, triangles drawn through the index buffer.
+        // Texcoords and tangents never change and are uploaded only here.
+        std::vector<glm::vec2> tex(nodeCount);
+        std::vector<glm::vec3> tan(nodeCount);
+        const ParticleData& p = cloth->particles;
+        for (int n = 0; n < nodeCount; ++n) {
+            tex[n] = glm::vec2(p.texCoord[n].x, p.texCoord[n].y);
+            tan[n] = glm::vec3(p.tangent[n].x, p.tangent[n].y, p.tangent[n].z);
         }
 
+        persistent = allowPersistent && (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage);
+        region = 0;
+        regionsChecked = 0;
+        checkFailed = false;
+        mappedPos = nullptr;
+        mappedNor = nullptr;
+        for (int r = 0; r < STREAM_REGIONS; r++)
+            fences[r] = 0;
+        stats.wait = stats.convert = stats.upload = 0.0;
+
         glGenVertexArrays(1, &vaoID);
         glGenBuffers(4, vboIDs);
+        glGenBuffers(1, &eboID);
 
         glBindVertexArray(vaoID);
+        createStreams();
 
         glBindBuffer(GL_ARRAY_BUFFER, vboIDs[0]);
-        glBufferData(GL_ARRAY_BUFFER, nodeCount * sizeof(glm::vec3), vboPos, GL_DYNAMIC_DRAW);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
         glEnableVertexAttribArray(0);
 
         glBindBuffer(GL_ARRAY_BUFFER, vboIDs[1]);
-        glBufferData(GL_ARRAY_BUFFER, nodeCount * sizeof(glm::vec2), vboTex, GL_DYNAMIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, nodeCount * sizeof(glm::vec2), tex.data(), GL_STATIC_DRAW);
         glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
         glEnableVertexAttribArray(1);
 
         glBindBuffer(GL_ARRAY_BUFFER, vboIDs[2]);
-        glBufferData(GL_ARRAY_BUFFER, nodeCount * sizeof(glm::vec3), vboNor, GL_DYNAMIC_DRAW);
         glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
         glEnableVertexAttribArray(2);
 
         glBindBuffer(GL_ARRAY_BUFFER, vboIDs[3]);
-        glBufferData(GL_ARRAY_BUFFER, nodeCount * sizeof(glm::vec3), vboTan, GL_DYNAMIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, nodeCount * sizeof(glm::vec3), tan.data(), GL_STATIC_DRAW);
         glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
         glEnableVertexAttribArray(3);
 
+        // The element buffer binding is part of the VAO state
+        static_assert(sizeof(cloth->faces[0]) == sizeof(GLuint), "faces are uploaded as GL_UNSIGNED_INT");
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eboID);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(GLuint), cloth->faces.data(), GL_STATIC_DRAW);
+
         glBindVertexArray(0);
     }
 
+    ~ClothRender() {
+        destroy();
+    }
+
+    // Position and normal streams. Immutable storage can't be respecified,
+    // so when mapping fails the buffers are recreated for glBufferSubData.
+    void createStreams() {
+        regionCount = persistent ? STREAM_REGIONS : 1;
+        glBindBuffer(GL_ARRAY_BUFFER, vboIDs[0]);
+        mappedPos = createStream();
+        glBindBuffer(GL_ARRAY_BUFFER, vboIDs[2]);
+        mappedNor = createStream();
+
+        if (persistent && (!mappedPos || !mappedNor)) {
+            std::cerr << "ERROR::ClothRender : Can't map the vertex streams, falling back to glBufferSubData" << std::endl;
+            glDeleteBuffers(1, &vboIDs[0]);
+            glDeleteBuffers(1, &vboIDs[2]);
+            glGenBuffers(1, &vboIDs[0]);
+            glGenBuffers(1, &vboIDs[2]);
+            persistent = false;
+            createStreams();
+            return;
+        }
+
+        if (!persistent) {
+            stagingPos.resize(nodeCount * 3);
+            stagingNor.resize(nodeCount * 3);
+        }
+    }
+
+    // Storage of the stream bound to GL_ARRAY_BUFFER, mapped if persistent
+    float* createStream() {
+        GLsizeiptr bytes = (GLsizeiptr)regionCount * nodeCount * sizeof(glm::vec3);
+        if (!persistent) {
+            glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_DYNAMIC_DRAW);
+            return nullptr;
+        }
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, flags);
+        return (float*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags);
+    }
+
+    void waitRegion(int r) {
+        if (!fences[r])
+            return;
+        GLenum status = glClientWaitSync(fences[r], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        while (status == GL_TIMEOUT_EXPIRED)
+            status = glClientWaitSync(fences[r], 0, 1000000);
+        glDeleteSync(fences[r]);
+        fences[r] = 0;
+    }
+
+    // Whether region r of the stream in vbo holds the floats just written
+    bool checkStream(GLuint vbo, const float* written) {
+        size_t floats = (size_t)nodeCount * 3;
+        std::vector<float> back(floats);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glGetBufferSubData(GL_ARRAY_BUFFER, (GLintptr)region * floats * sizeof(float), floats * sizeof(float), back.data());
+        return std::memcmp(back.data(), written, floats * sizeof(float)) == 0;
+    }
+
     void flush() {
-        for (int i = 0; i < nodeCount; ++i) {
-            Node* n = cloth->faces[i];
-            vboPos[i] = glm::vec3(n->position.x, n->position.y, n->position.z);
-            vboNor[i] = glm::vec3(n->normal.x, n->normal.y, n->normal.z);
+        typedef std::chrono::steady_clock Clock;
+        const ParticleData& p = cloth->particles;
+        size_t floats = (size_t)nodeCount * 3;
+
+        Clock::time_point t0 = Clock::now();
+        waitRegion(region);
+        float* pos = persistent ? mappedPos + region * floats : stagingPos.data();
+        float* nor = persistent ? mappedNor + region * floats : stagingNor.data();
+
+        Clock::time_point t1 = Clock::now();
+        convertToFloat(&p.position[0].x, pos, floats);
+        convertToFloat(&p.normal[0].x, nor, floats);
+
+        Clock::time_point t2 = Clock::now();
+        if (!persistent) {
+            glBindBuffer(GL_ARRAY_BUFFER, vboIDs[0]);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, floats * sizeof(float), pos);
+            glBindBuffer(GL_ARRAY_BUFFER, vboIDs[2]);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, floats * sizeof(float), nor);
         }
+        Clock::time_point t3 = Clock::now();
+
+#ifndef NDEBUG
+        if (regionsChecked < regionCount) {
+            if (!checkStream(vboIDs[0], pos) || !checkStream(vboIDs[2], nor)) {
+                std::cerr << "ERROR::ClothRender : Stream region " << region << " doesn't read back as written ("
+                          << (persistent ? "persistent" : "glBufferSubData") << ")" << std::endl;
+                checkFailed = true;
+            }
+            regionsChecked++;
+        }
+#endif
+
+        const double smoothing = 0.1;
+        stats.wait += (std::chrono::duration<double, std::milli>(t1 - t0).count() - stats.wait) * smoothing;
+        stats.convert += (std::chrono::duration<double, std::milli>(t2 - t1).count() - stats.convert) * smoothing;
+        stats.upload += (std::chrono::duration<double, std::milli>(t3 - t2).count() - stats.upload) * smoothing;
 
         shader.use();
         glBindVertexArray(vaoID);
 
-        glBindBuffer(GL_ARRAY_BUFFER, vboIDs[0]);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, nodeCount * sizeof(glm::vec3), vboPos);
-        glBindBuffer(GL_ARRAY_BUFFER, vboIDs[1]);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, nodeCount * sizeof(glm::vec2), vboTex);
-        glBindBuffer(GL_ARRAY_BUFFER, vboIDs[2]);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, nodeCount * sizeof(glm::vec3), vboNor);
-        glBindBuffer(GL_ARRAY_BUFFER, vboIDs[3]);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, nodeCount * sizeof(glm::vec3), vboTan);
-
         // vertex shader
         material.Bind(shader);
 
@@ -137,18 +272,31 @@ struct ClothRender {
         glDisable(GL_BLEND);
         glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         
+        // This frame's positions and normals start at region * nodeCount.
+        // Only those two streams are ringed, so they alone are re-pointed:
+        // a base vertex would offset the texcoords and tangents too.
+        GLintptr offset = (GLintptr)region * nodeCount * sizeof(glm::vec3);
+        glBindBuffer(GL_ARRAY_BUFFER, vboIDs[0]);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)offset);
+        glBindBuffer(GL_ARRAY_BUFFER, vboIDs[2]);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)offset);
+
         //Draw
         switch (this->clothInstance->drawMode) {
             case ClothInstance::DRAW_NODES:
                 glDrawArrays(GL_POINTS, 0, nodeCount);
                 break;
             case ClothInstance::DRAW_LINES:
-                glDrawArrays(GL_LINES, 0, nodeCount);
+                glDrawElements(GL_LINES, indexCount, GL_UNSIGNED_INT, (void*)0);
                 break;
             default:
-                glDrawArrays(GL_TRIANGLES, 0, nodeCount);
+                glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (void*)0);
                 break;
         }
+        if (persistent)
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        region = (region + 1) % regionCount;
+
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
         glUseProgram(0);
@@ -157,18 +305,27 @@ struct ClothRender {
     }
 
     void destroy() {
-        delete[] vboPos;
-        delete[] vboTex;
-        delete[] vboNor;
-        delete[] vboTan;
+        if (vaoID == 0)
+            return;
+        for (int r = 0; r < STREAM_REGIONS; r++) {
+            if (fences[r])
+                glDeleteSync(fences[r]);
+            fences[r] = 0;
+        }
+        // Deleting a buffer unmaps it
         glDeleteVertexArrays(1, &vaoID);
         glDeleteBuffers(4, vboIDs);
+        glDeleteBuffers(1, &eboID);
+        mappedPos = nullptr;
+        mappedNor = nullptr;
+        vaoID = 0;
     }
 };
 
 struct SpringRender
 {
-    std::vector<Spring*> springs;
+    const ParticleData* particles;
+    const SpringData* springs;
     int springCount; // Number of nodes in springs
     
     glm::vec4 uniSpringColor;
@@ -184,10 +341,11 @@ struct SpringRender
     GLint aPtrNor;
     
     // Render any spring set, color and modelVector
-    void init(std::vector<Spring*> s, glm::vec4 c, glm::vec3 modelVec)
+    void init(const ParticleData* p, const SpringData* s, glm::vec4 c, glm::vec3 modelVec)
     {
+        particles = p;
         springs = s;
-        springCount = (int)(springs.size());
+        springCount = (int)(springs->size());
         if (springCount <= 0) {
             std::cout << "ERROR::SpringRender : No node exists." << std::endl;
             exit(-1);
@@ -198,12 +356,14 @@ struct SpringRender
         vboPos = new glm::vec3[springCount*2];
         vboNor = new glm::vec3[springCount*2];
         for (int i = 0; i < springCount; i ++) {
-            Node* node1 = springs[i]->node1;
-            Node* node2 = springs[i]->node2;
-            vboPos[i*2] = glm::vec3(node1->position.x, node1->position.y, node1->position.z);
-            vboPos[i*2+1] = glm::vec3(node2->position.x, node2->position.y, node2->position.z);
-            vboNor[i*2] = glm::vec3(node1->normal.x, node1->normal.y, node1->normal.z);
-            vboNor[i*2+1] = glm::vec3(node2->normal.x, node2->normal.y, node2->normal.z);
+            const Vec3& pos1 = particles->position[springs->node1[i]];
+            const Vec3& pos2 = particles->position[springs->node2[i]];
+            const Vec3& nor1 = particles->normal[springs->node1[i]];
+            const Vec3& nor2 = particles->normal[springs->node2[i]];
+            vboPos[i*2] = glm::vec3(pos1.x, pos1.y, pos1.z);
+            vboPos[i*2+1] = glm::vec3(pos2.x, pos2.y, pos2.z);
+            vboNor[i*2] = glm::vec3(nor1.x, nor1.y, nor1.z);
+            vboNor[i*2+1] = glm::vec3(nor2.x, nor2.y, nor2.z);
         }
         
         //Build render program
@@ -279,12 +439,14 @@ struct SpringRender
     {
         // Update all the positions of nodes
         for (int i = 0; i < springCount; i ++) {
-            Node* node1 = springs[i]->node1;
-            Node* node2 = springs[i]->node2;
-            vboPos[i*2] = glm::vec3(node1->position.x, node1->position.y, node1->position.z);
-            vboPos[i*2+1] = glm::vec3(node2->position.x, node2->position.y, node2->position.z);
-            vboNor[i*2] = glm::vec3(node1->normal.x, node1->normal.y, node1->normal.z);
-            vboNor[i*2+1] = glm::vec3(node2->normal.x, node2->normal.y, node2->normal.z);
+            const Vec3& pos1 = particles->position[springs->node1[i]];
+            const Vec3& pos2 = particles->position[springs->node2[i]];
+            const Vec3& nor1 = particles->normal[springs->node1[i]];
+            const Vec3& nor2 = particles->normal[springs->node2[i]];
+            vboPos[i*2] = glm::vec3(pos1.x, pos1.y, pos1.z);
+            vboPos[i*2+1] = glm::vec3(pos2.x, pos2.y, pos2.z);
+            vboNor[i*2] = glm::vec3(nor1.x, nor1.y, nor1.z);
+            vboNor[i*2+1] = glm::vec3(nor2.x, nor2.y, nor2.z);
         }
         
         glUseProgram(programID);
@@ -324,7 +486,7 @@ struct ClothSpringRender
     {
         cloth = c;
         defaultColor = glm::vec4(0.25, 0.05, 0.0, 1.0);
-        render.init(cloth->getData()->springs, defaultColor, glm::vec3(cloth->getData()->clothPos.x, cloth->getData()->clothPos.y, cloth->getData()->clothPos.z));
+        render.init(&cloth->getData()->particles, &cloth->getData()->springs, defaultColor, glm::vec3(cloth->getData()->clothPos.x, cloth->getData()->clothPos.y, cloth->getData()->clothPos.z));
     }
     
     void flush() { render.flush(); }
@@ -470,7 +632,7 @@ struct RigidRender // Single color & Lighting
     }
 };
 
-struct GroundRender
+struct GroundRender : public ColliderRender
 {
     Ground* ground;
     RigidRender render;
@@ -481,10 +643,10 @@ struct GroundRender
         render.init(ground->faces, ground->color, glm::vec3(ground->position.x, ground->position.y, ground->position.z));
     }
 
-    void flush() { render.flush(); }
+    void flush() override { render.flush(); }
 };
 
-struct SphereRender
+struct SphereRender : public ColliderRender
 {
     Sphere* sphere;
     RigidRender render;
@@ -496,10 +658,10 @@ struct SphereRender
         //render.init(sphere->faces, sphere->color, glm::vec3(0.0, 0.0, 0.0));
     }
 
-    void flush() { render.flush(); }
+    void flush() override { render.flush(); }
 };
 
-struct BoxRender
+struct BoxRender : public ColliderRender
 {
     Box* box;
     RigidRender render;
@@ -511,10 +673,10 @@ struct BoxRender
         render.init(box->faces, box->color, glm::vec3(0.0, 0.0, 0.0));
     }
 
-    void flush() { render.flush(); }
+    void flush() override { render.flush(); }
 };
 
-struct CapsuleRender
+struct CapsuleRender : public ColliderRender
 {
     Capsule* capsule;
     RigidRender render;
@@ -526,10 +688,10 @@ struct CapsuleRender
         render.init(capsule->faces, capsule->color, glm::vec3(0.0, 0.0, 0.0));
     }
 
-    void flush() { render.flush(); }
+    void flush() override { render.flush(); }
 };
 
-struct SweptSphereRender
+struct SweptSphereRender : public ColliderRender
 {
     SweptSphere* sweptSphere;
     RigidRender render;
@@ -540,10 +702,10 @@ struct SweptSphereRender
         render.init(sweptSphere->faces, sweptSphere->color, glm::vec3(0.0, 0.0, 0.0));
     }
 
-    void flush() { render.flush(); }
+    void flush() override { render.flush(); }
 };
 
-struct SweptSphereTriRender
+struct SweptSphereTriRender : public ColliderRender
 {
     SweptSphereTri* sweptSphereTri;
     RigidRender render;
@@ -554,8 +716,32 @@ struct SweptSphereTriRender
         render.init(sweptSphereTri->faces, sweptSphereTri->color, glm::vec3(0.0, 0.0, 0.0));
     }
 
-    void flush() { render.flush(); }
+    void flush() override { render.flush(); }
 };
+
+// Creates the render of a collider made by the simulation core, and of the
+// primitives of a sphere mesh. Returns the collider, for addCollider.
+inline ICollider* attachRender(ICollider* collider)
+{
+    if (SphereCollider* c = dynamic_cast<SphereCollider*>(collider))
+        c->renderer = new SphereRender(c->sphere);
+    else if (AABBCollider* c = dynamic_cast<AABBCollider*>(collider))
+        c->renderer = new BoxRender(c->box);
+    else if (CapsuleCollider* c = dynamic_cast<CapsuleCollider*>(collider))
+        c->renderer = new CapsuleRender(c->capsule);
+    else if (SweptSphereCollider* c = dynamic_cast<SweptSphereCollider*>(collider))
+        c->renderer = new SweptSphereRender(c->sweptsphere);
+    else if (SweptSphereTriCollider* c = dynamic_cast<SweptSphereTriCollider*>(collider))
+        c->renderer = new SweptSphereTriRender(c->sweptspheretri);
+    else if (GroundCollider* c = dynamic_cast<GroundCollider*>(collider))
+        c->renderer = new GroundRender(c->ground);
+    else if (SphereMeshesCollider* c = dynamic_cast<SphereMeshesCollider*>(collider)) {
+        for (ICollider* p : c->primitives)
+            attachRender(p);
+    }
+    return collider;
+}
+
 #endif
 
 
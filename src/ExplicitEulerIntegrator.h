@@ -6,6 +6,7 @@
 #include "IClothSimulator.h"
 #include "Vectors.h"
 #include "ICollider.h"
+#include "GridStencil.h"
 
 class ExplicitEulerIntegrator : public IClothSimulator {
 public:
@@ -25,6 +26,7 @@ private:
 	double stretchingCoef;
 	double bendingCoef;
 	double shearCoef;
+	GridStencil stencil; // Spring list replacement for grid cloth
 
 	void initCoeff();
 	void removeZeroCoeffSpring();
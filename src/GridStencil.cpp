@@ -0,0 +1,245 @@
+#include <cstdlib>
+
+#include "GridStencil.h"
+#include "ClothData.h"
+
+// Link directions, in the order of the class comment
+static constexpr int LINK_X[GridStencil::LINKS] = { 1, 0, -1, 1, 2, 0 };
+static constexpr int LINK_Y[GridStencil::LINKS] = { 0, 1, 1, 1, 0, 2 };
+
+GridStencil::GridStencil() : width(0), height(0), pad(0), dampCoef(0.0)
+{
+    for (int d = 0; d < LINKS; d++) {
+        enabled[d] = false;
+        coef[d] = 0.0;
+    }
+}
+
+bool GridStencil::build(const ClothData& cloth)
+{
+    width = 0;
+    const ParticleData& p = cloth.particles;
+    const SpringData& springs = cloth.springs;
+    const int W = cloth.nodesPerRow;
+    if (W <= 0 || cloth.nodesPerCol <= 0 || p.size() != (size_t)W * cloth.nodesPerCol)
+        return false;
+    const int H = (int)p.size() / W;
+
+    // Every spring has to be one stencil link, every direction either
+    // complete with a single coefficient or absent
+    size_t count[LINKS] = {};
+    for (int d = 0; d < LINKS; d++) {
+        enabled[d] = false;
+        rest[d].assign(p.size(), 0.0);
+    }
+    for (size_t s = 0; s < springs.size(); s++) {
+        int n1 = springs.node1[s];
+        int n2 = springs.node2[s];
+        int dx = n2 % W - n1 % W;
+        int dy = n2 / W - n1 / W;
+
+        int d = 0;
+        int anchor = n1;
+        for (; d < LINKS; d++) {
+            if (dx == LINK_X[d] && dy == LINK_Y[d])
+                break;
+            if (dx == -LINK_X[d] && dy == -LINK_Y[d]) {
+                anchor = n2;
+                break;
+            }
+        }
+        if (d == LINKS || rest[d][anchor] != 0.0)
+            return false;
+
+        if (!enabled[d]) {
+            enabled[d] = true;
+            coef[d] = springs.hookCoef[s];
+        }
+        else if (coef[d] != springs.hookCoef[s])
+            return false;
+        rest[d][anchor] = springs.restLen[s];
+        count[d]++;
+    }
+
+    degree.assign(p.size(), 0);
+    for (int d = 0; d < LINKS; d++) {
+        if (!enabled[d])
+            continue;
+        if (count[d] != (size_t)(W - std::abs(LINK_X[d])) * (H - LINK_Y[d]))
+            return false;
+
+        int offset = LINK_Y[d] * W + LINK_X[d];
+        for (size_t n = 0; n < p.size(); n++) {
+            if (rest[d][n] != 0.0) {
+                degree[n]++;
+                degree[n + offset]++;
+            }
+        }
+    }
+
+    pad = 2 * W + 2;
+    for (int d = 0; d < LINKS; d++)
+        record[d].assign(enabled[d] ? p.size() + pad : 0, Vec3());
+    dampCoef = springs.dampCoef;
+    width = W;
+    height = H;
+    return true;
+}
+
+template <int D>
+void GridStencil::linkForces(const ParticleData& p)
+{
+    // Same force as SpringData::computeInternalForce, anchor as node1
+    constexpr int DX = LINK_X[D];
+    constexpr int DY = LINK_Y[D];
+    const int offset = DY * width + DX;
+    const int x0 = DX < 0 ? -DX : 0;
+    const int x1 = DX > 0 ? width - DX : width;
+    const double k = coef[D];
+    const double* len = rest[D].data();
+    Vec3* rec = record[D].data() + pad;
+
+#pragma omp parallel for
+    for (int y = 0; y < height - DY; y++) {
+        for (int x = x0; x < x1; x++) {
+            int n = y * width + x;
+            int m = n + offset;
+            Vec3 d = Vec3(p.position[m]) - p.position[n];
+            double currLen = d.length();
+            Vec3 dir = d / currLen;
+            Vec3 dv = Vec3(p.velocity[m]) - p.velocity[n];
+            rec[n] = dir * ((currLen - len[n]) * k + Vec3::dot(dv, dir) * dampCoef);
+        }
+    }
+}
+
+template <int D>
+void GridStencil::projectLinks(ParticleData& p, double timeStep, int color)
+{
+    // Same projection as PositionBasedIntegrator::solveConstraint. Links of
+    // one color share no node: every other column (pair of columns for
+    // bending) along x, every other row (pair of rows) otherwise.
+    constexpr int DX = LINK_X[D];
+    constexpr int DY = LINK_Y[D];
+    const int offset = DY * width + DX;
+    const int x0 = DX < 0 ? -DX : 0;
+    const int x1 = DX > 0 ? width - DX : width;
+    const double alpha = coef[D] / timeStep / timeStep;
+    const double* len = rest[D].data();
+
+#pragma omp parallel for
+    for (int y = 0; y < height - DY; y++) {
+        if (DY > 0 && (y / DY) % 2 != color)
+            continue;
+        for (int x = x0; x < x1; x++) {
+            if (DY == 0 && (x / DX) % 2 != color)
+                continue;
+            int n = y * width + x;
+            int m = n + offset;
+            double w = p.invMass[n] + p.invMass[m];
+            if (w == 0.0)
+                continue;
+
+            Vec3 distance = p.position[n] - p.position[m];
+            double currLen = distance.length();
+            if (currLen == 0.0)
+                continue;
+
+            distance.normalize();
+            double correction = -(currLen - len[n]) / (w + alpha);
+            p.position[n] += distance * (correction * p.invMass[n]);
+            p.position[m] += distance * (-correction * p.invMass[m]);
+        }
+    }
+}
+
+template <int D>
+void GridStencil::linkCorrections(const ParticleData& p, double timeStep)
+{
+    // Same correction as PositionBasedIntegrator::solveConstraintJacobi
+    constexpr int DX = LINK_X[D];
+    constexpr int DY = LINK_Y[D];
+    const int offset = DY * width + DX;
+    const int x0 = DX < 0 ? -DX : 0;
+    const int x1 = DX > 0 ? width - DX : width;
+    const double alpha = coef[D] / timeStep / timeStep;
+    const double* len = rest[D].data();
+    Vec3* rec = record[D].data() + pad;
+
+#pragma omp parallel for
+    for (int y = 0; y < height - DY; y++) {
+        for (int x = x0; x < x1; x++) {
+            int n = y * width + x;
+            int m = n + offset;
+            double w = p.invMass[n] + p.invMass[m];
+            Vec3 distance = Vec3(p.position[n]) - p.position[m];
+            double currLen = distance.length();
+            if (w == 0.0 || currLen == 0.0) {
+                rec[n] = Vec3();
+                continue;
+            }
+
+            rec[n] = distance * (-(currLen - len[n]) / (currLen * (w + alpha)));
+        }
+    }
+}
+
+Vec3 GridStencil::gather(int n) const
+{
+    // Records of links anchored at n, minus those ending at n. Links leaving
+    // the grid were never written and read as zero.
+    Vec3 sum;
+    for (int d = 0; d < LINKS; d++) {
+        if (!enabled[d])
+            continue;
+        const Vec3* rec = record[d].data() + pad;
+        sum += rec[n];
+        sum -= rec[n - (LINK_Y[d] * width + LINK_X[d])];
+    }
+    return sum;
+}
+
+void GridStencil::computeForce(ParticleData& p, Vec3 gravity)
+{
+    if (enabled[0]) linkForces<0>(p);
+    if (enabled[1]) linkForces<1>(p);
+    if (enabled[2]) linkForces<2>(p);
+    if (enabled[3]) linkForces<3>(p);
+    if (enabled[4]) linkForces<4>(p);
+    if (enabled[5]) linkForces<5>(p);
+
+#pragma omp parallel for
+    for (int n = 0; n < (int)p.size(); n++) {
+        p.force[n] += gravity * p.mass[n];
+        p.force[n] += gather(n);
+    }
+}
+
+void GridStencil::solveConstraint(ParticleData& p, double timeStep)
+{
+    // Direction by direction, red then black
+    if (enabled[0]) { projectLinks<0>(p, timeStep, 0); projectLinks<0>(p, timeStep, 1); }
+    if (enabled[1]) { projectLinks<1>(p, timeStep, 0); projectLinks<1>(p, timeStep, 1); }
+    if (enabled[2]) { projectLinks<2>(p, timeStep, 0); projectLinks<2>(p, timeStep, 1); }
+    if (enabled[3]) { projectLinks<3>(p, timeStep, 0); projectLinks<3>(p, timeStep, 1); }
+    if (enabled[4]) { projectLinks<4>(p, timeStep, 0); projectLinks<4>(p, timeStep, 1); }
+    if (enabled[5]) { projectLinks<5>(p, timeStep, 0); projectLinks<5>(p, timeStep, 1); }
+}
+
+void GridStencil::solveConstraintJacobi(ParticleData& p, double timeStep, double sorFactor)
+{
+    if (enabled[0]) linkCorrections<0>(p, timeStep);
+    if (enabled[1]) linkCorrections<1>(p, timeStep);
+    if (enabled[2]) linkCorrections<2>(p, timeStep);
+    if (enabled[3]) linkCorrections<3>(p, timeStep);
+    if (enabled[4]) linkCorrections<4>(p, timeStep);
+    if (enabled[5]) linkCorrections<5>(p, timeStep);
+
+#pragma omp parallel for
+    for (int n = 0; n < (int)p.size(); n++) {
+        if (p.invMass[n] == 0.0 || degree[n] == 0)
+            continue;
+
+        p.position[n] += gather(n) * (sorFactor * p.invMass[n] / degree[n]);
+    }
+}
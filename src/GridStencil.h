@@ -0,0 +1,53 @@
+#ifndef GRID_STENCIL_H
+#define GRID_STENCIL_H
+
+#include "ParticleData.h"
+#include "Vectors.h"
+
+class ClothData;
+
+// Spring forces and PBD projections of grid built cloth straight from the
+// node layout, without the spring list. Node (x, y) is y * width + x and
+// link direction d joins (x, y) to (x + dx, y + dy): stretch (1, 0) (0, 1),
+// shear (-1, 1) (1, 1), bending (2, 0) (0, 2). Every direction is its own
+// kernel with compile-time offsets, looping along rows.
+class GridStencil {
+public:
+    enum { LINKS = 6 };
+
+    GridStencil();
+
+    // Takes over the springs of a BuildGrid cloth, in its build numbering,
+    // with one coefficient per direction (what initCoeff leaves). Returns
+    // false, and stays inactive, for any other topology.
+    bool build(const ClothData& cloth);
+    bool active() const { return width > 0; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // force += gravity * m + spring and damping forces
+    void computeForce(ParticleData& p, Vec3 gravity);
+
+    // Gauss-Seidel projection, red-black per direction (2 colors each), or
+    // averaged Jacobi corrections over-relaxed by sorFactor
+    void solveConstraint(ParticleData& p, double timeStep);
+    void solveConstraintJacobi(ParticleData& p, double timeStep, double sorFactor);
+
+private:
+    int width;
+    int height;
+    int pad; // Records are shifted by pad, so n - offset never underflows
+    double dampCoef;
+    bool enabled[LINKS];
+    double coef[LINKS]; // Stiffness, or PBD compliance
+    AlignedVector<double> rest[LINKS]; // Per anchor node, 0 where the link leaves the grid
+    AlignedVector<Vec3> record[LINKS]; // Force (or correction) on the anchor, partner gets the opposite
+    AlignedVector<unsigned char> degree;
+
+    template <int D> void linkForces(const ParticleData& p);
+    template <int D> void projectLinks(ParticleData& p, double timeStep, int color);
+    template <int D> void linkCorrections(const ParticleData& p, double timeStep);
+    Vec3 gather(int n) const;
+};
+
+#endif
@@ -2,7 +2,6 @@
 #include "Ground.h"
 #include "GroundCollider.h"
 #include "Vectors.h"
-#include "Display.h"
 
 
 GroundCollider::GroundCollider() {
@@ -11,24 +10,38 @@ GroundCollider::GroundCollider() {
 	glm::vec4 groundColor(0.3f, 0.3f, 0.3f, 0.4f);
 
 	ground = new Ground(groundPos, groundSize, groundColor);
-	renderer = new GroundRender(ground);
 }
 
 GroundCollider::~GroundCollider() {
 	delete ground;
-	delete renderer;
 }
 
 void GroundCollider::resolveCollision(ClothData* data) {
 #pragma omp parallel for
-	for (int i = 0; i < data->nodes.size(); ++i) {
-		if (data->getWorldPos(data->nodes[i]).y < ground->position.y) {
-			data->nodes[i]->position.y = ground->position.y - data->clothPos.y + 0.01;
-			data->nodes[i]->velocity = data->nodes[i]->velocity * ground->friction;
+	for (int i = 0; i < data->particles.size(); ++i) {
+		if (data->getWorldPos(i).y < ground->position.y) {
+			data->particles.position[i].y = ground->position.y - data->clothPos.y + 0.01;
+			data->particles.velocity[i] = data->particles.velocity[i] * ground->friction;
 		}
 	}
 }
 
-void GroundCollider::render() {
-	renderer->flush();
-}
\ No newline at end of file
+bool GroundCollider::closestSurface(Vec3 p, Vec3& surface, Vec3& normal) {
+	if (p.y >= ground->position.y)
+		return false;
+
+	surface = Vec3(p.x, ground->position.y + 0.01, p.z);
+	normal = Vec3(0.0, 1.0, 0.0);
+	return true;
+}
+
+// Resting nodes sit 0.01 above the plane: keep them in contact too
+void GroundCollider::collectContacts(ClothData* data, const AlignedVector<Vec3>& positions, std::vector<Contact>& contacts) {
+	double height = ground->position.y - data->clothPos.y + 0.01;
+	for (unsigned int i = 0; i < data->particles.size(); ++i) {
+		if (positions[i].y < height) {
+			Contact c = { i, Vec3(positions[i].x, height, positions[i].z), Vec3(0.0, 1.0, 0.0) };
+			contacts.push_back(c);
+		}
+	}
+}
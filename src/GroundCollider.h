@@ -6,16 +6,14 @@
 #include "Vectors.h"
 #include "Ground.h"
 
-class GroundRender;
-
 class GroundCollider : public ICollider {
 public:
     Ground* ground;
-	GroundRender* renderer;
 
     GroundCollider();
     void resolveCollision(ClothData* data) override;
-    void render() override;
+    bool closestSurface(Vec3 p, Vec3& surface, Vec3& normal) override;
+    void collectContacts(ClothData* data, const AlignedVector<Vec3>& positions, std::vector<Contact>& contacts) override;
     ~GroundCollider();
 };
 
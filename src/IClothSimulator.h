@@ -10,6 +10,8 @@ public:
 	virtual void unpin() = 0;
     virtual std::vector<ICollider*> getColliders() = 0;
     virtual void addCollider(ICollider* col) = 0;
+    virtual void setStiffness(double stretching, double shear, double bending) {} // Runtime edit, ignored by default
+    virtual void restart() {} // The cloth was reset: drop state carried over from the last steps
     virtual ~IClothSimulator() {}
 };
 
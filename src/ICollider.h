@@ -1,14 +1,49 @@
 #ifndef ICOLLIDER_H
 #define ICOLLIDER_H
 
+#include <vector>
 #include "ClothData.h"
 
+// Contact for the implicit solvers: node should stay on the outer side of the
+// plane through point (cloth coordinates, the closest safe surface point) with normal
+struct Contact {
+	unsigned int node;
+	Vec3 point;
+	Vec3 normal;
+};
+
+// GL drawing of a collider, the render structs of Display.h
+class ColliderRender {
+public:
+	virtual void flush() = 0;
+	virtual ~ColliderRender() = default;
+};
+
 class ICollider {
 public:
+	// Attached by the application (attachRender in Display.h), never by the
+	// simulation: colliders build and run without GL
+	ColliderRender* renderer = nullptr;
+
 	virtual void resolveCollision(ClothData* data) = 0; 
-	virtual void render() = 0;
-	virtual ~ICollider() = default;
+	virtual void render() { if (renderer) renderer->flush(); }
+	virtual ~ICollider() { delete renderer; }
+
+	// Where a node at world position p goes to clear the collider (the
+	// closest safe surface point) and the outward normal there. False if
+	// p is already clear.
+	virtual bool closestSurface(Vec3 p, Vec3& surface, Vec3& normal) = 0;
 
+	// Contacts of the cloth at positions, without moving it
+	virtual void collectContacts(ClothData* data, const AlignedVector<Vec3>& positions, std::vector<Contact>& contacts) {
+		for (unsigned int i = 0; i < data->particles.size(); ++i) {
+			Vec3 surface, normal;
+			if (closestSurface(Vec3(positions[i]) + data->clothPos, surface, normal)) {
+				Contact c = { i, surface - data->clothPos, normal };
+				contacts.push_back(c);
+			}
+		}
+	}
 };
 
 #endif
\ No newline at end of file
@@ -1,19 +1,21 @@
 #include <iostream>
 #include <iomanip>
+#include <cmath>
 
 
 #include "ImplicitNewtonIntegrator.h"
 #include "ClothData.h"
 #include "Vectors.h"
 #include <Eigen/Dense>
+#include <algorithm>
 
 using namespace std;
 
-ImplicitNewtonIntegrator::ImplicitNewtonIntegrator(ClothData* data)
+ImplicitNewtonIntegrator::ImplicitNewtonIntegrator(ClothData* data, std::string m)
     : cloth(data),
-    J(data->nodes.size() * 3, data->nodes.size() * 3),
-    M(data->nodes.size() * 3, data->nodes.size() * 3),
-    G(data->nodes.size() * 3)
+    method(m),
+    J(data->particles.size() * 3, data->particles.size() * 3),
+    G(data->particles.size() * 3)
 {
     TIME_STEP = 0.01;
     stretchingCoef = 1000.0f;
@@ -21,15 +23,51 @@ ImplicitNewtonIntegrator::ImplicitNewtonIntegrator(ClothData* data)
     shearCoef = 50.0;
     gravity = Vec3(0.0, -9.8, 0.0);
 
-    maxIterations = 1;
-    convergenceTol = 1e-5;
+    maxIterations = 4;
+    convergenceTol = 1e-3;
+    lineSearchSteps = 8;
+    iterations = 0;
+
+    pcg = (method == "NewtonPCG");
+    cgMaxIterations = 100;
+    cgTolerance = 1e-4;
+    // Assembling J_blocks costs a few matrix-free products and makes every
+    // product after it cheaper. Most solves converge within a few iterations,
+    // so PCG stays matrix-free that long; tune with the cost ratio of the two.
+    cgAssembleIterations = 6;
+    blocksAssembled = false;
+    cgIterations = 0;
 
     initCoeff();
-    initVars();
     removeZeroCoeffSpring();
+    initVars();
 
+    jacobianBlocks.resize(cloth->springs.size());
 
+    std::cout << "Method: " << std::endl;
+    std::cout << "- " << method << std::endl;
+    if (pcg)
+        std::cout << "- block Jacobi PCG, tolerance: " << cgTolerance << ", max iterations: " << cgMaxIterations << std::endl;
+    else
+        std::cout << "- sparse LDLT" << std::endl;
+    std::cout << "- Newton iterations: " << maxIterations << ", tolerance: " << convergenceTol << std::endl;
 }
+
+void ImplicitNewtonIntegrator::setNewtonIterations(int maxIter, double tol) {
+    maxIterations = std::max(maxIter, 1);
+    convergenceTol = tol;
+}
+
+void ImplicitNewtonIntegrator::setCGIterations(int maxIter, double tol) {
+    cgMaxIterations = std::max(maxIter, 1);
+    cgTolerance = tol;
+}
+
+void ImplicitNewtonIntegrator::restart() {
+    // The warm start is the last step's correction, meaningless for the reset cloth
+    delta_warm.setZero();
+}
+
 std::vector<ICollider*> ImplicitNewtonIntegrator::getColliders() {
     return colliders;
 }
@@ -40,36 +78,39 @@ void ImplicitNewtonIntegrator::addCollider(ICollider* col) {
 
 void ImplicitNewtonIntegrator::initVars() {
 
-    for (int i = 0; i < cloth->nodes.size(); ++i) {
-        cloth->nodes[i]->residual_G = Vec3(0.0, 0.0, 0.0);
-    }
-
-	// Initialize jacobian matrix J
-    std::vector<Eigen::Triplet<double>> triplets;
-    for (int k = 0;k < cloth->springs.size(); ++k) {
-        for (int i = 0; i < 3; ++i) {
-            for (int j = 0; j < 3; ++j) {
-                triplets.push_back(Eigen::Triplet<double>(cloth->springs[k]->node1->id + i, cloth->springs[k]->node1->id + j, 1.0));
-                triplets.push_back(Eigen::Triplet<double>(cloth->springs[k]->node1->id + i, cloth->springs[k]->node2->id + j, 1.0));
-                triplets.push_back(Eigen::Triplet<double>(cloth->springs[k]->node2->id + i, cloth->springs[k]->node1->id + j, 1.0));
-                triplets.push_back(Eigen::Triplet<double>(cloth->springs[k]->node2->id + i, cloth->springs[k]->node2->id + j, 1.0));
-            }
+    ParticleData& p = cloth->particles;
+    SpringData& springs = cloth->springs;
+    G.setZero();
+    delta_x = Eigen::VectorXd::Zero(p.size() * 3);
+    delta_warm = Eigen::VectorXd::Zero(p.size() * 3);
+    start_velocity.resize(p.size());
+    trial.resize(p.size());
+    precond.resize(p.size());
+    springs.buildAdjacency(p.size());
+
+    // J in 3x3 block form: a block on the diagonal for every node (mass),
+    // plus the off-diagonal blocks of every spring
+    J_blocks.buildPattern(springs, p.size());
+    blockSlots.resize(springs.adjSpring.size());
+    for (int n = 0; n < p.size(); ++n) {
+        for (unsigned int k = springs.adjOffset[n]; k < springs.adjOffset[n + 1]; ++k) {
+            unsigned int s = springs.adjSpring[k] >> 1;
+            unsigned int other = (springs.adjSpring[k] & 1) ? springs.node1[s] : springs.node2[s];
+            blockSlots[k] = J_blocks.findBlock(n, other);
         }
     }
-    J.setFromTriplets(triplets.begin(), triplets.end());
-    solver.analyzePattern(J);
 
-	// Initialize mass matrix M
-	triplets.clear();
-
-    for (int i = 0; i < cloth->nodes.size(); ++i) {
-        for (int j = 0; j < 3; ++j) {
-            int idx = i * 3 + j;
-            triplets.push_back(Eigen::Triplet<double>(idx, idx, cloth->nodes[i]->mass));
-        }
+    if (pcg) {
+        cg_r.resize(p.size() * 3);
+        cg_s.resize(p.size() * 3);
+        cg_d.resize(p.size() * 3);
+        cg_q.resize(p.size() * 3);
+        return;
     }
 
-    M.setFromTriplets(triplets.begin(), triplets.end());
+    // The LDLT path factors a scalar copy of J_blocks, same pattern every step
+    J_blocks.toEigen(J);
+    solver.analyzePattern(J);
 }
 
 void ImplicitNewtonIntegrator::initCoeff() {
@@ -83,16 +124,16 @@ void ImplicitNewtonIntegrator::initCoeff() {
     //3: quad springs
 
     for (int s = 0; s < cloth->springs.size(); ++s) {
-        if (cloth->springs[s]->id == 0) {
-            cloth->springs[s]->hookCoef = stretchingCoef;
+        if (cloth->springs.type[s] == 0) {
+            cloth->springs.hookCoef[s] = stretchingCoef;
             stretchCount++;
         }
-        else if (cloth->springs[s]->id == 1 || cloth->springs[s]->id == 2) {
-            cloth->springs[s]->hookCoef = shearCoef;
+        else if (cloth->springs.type[s] == 1 || cloth->springs.type[s] == 2) {
+            cloth->springs.hookCoef[s] = shearCoef;
             shearCount++;
         }
-        else if (cloth->springs[s]->id == 3) {
-            cloth->springs[s]->hookCoef = bendingCoef;
+        else if (cloth->springs.type[s] == 3) {
+            cloth->springs.hookCoef[s] = bendingCoef;
             bendingCount++;
         }
         else {
@@ -102,27 +143,17 @@ void ImplicitNewtonIntegrator::initCoeff() {
 }
 
 void ImplicitNewtonIntegrator::removeZeroCoeffSpring() {
-    int removedCount = 0;
-
-
     // Remove springs with zero coefficient
-    for (int i = 0; i < cloth->springs.size(); i++) {
-        if (cloth->springs[i]->hookCoef == 0.0) {
-            delete cloth->springs[i];
-            cloth->springs.erase(cloth->springs.begin() + i);
-            i--;
-            removedCount++;
-        }
-    }
-
+    cloth->springs.removeZeroCoeff();
 }
 
 void ImplicitNewtonIntegrator::unpin() {
     int unpinnedCount = 0;
 
-    for (int i = 0; i < cloth->nodes.size(); ++i) {
-        if (cloth->nodes[i]->isFixed) {
-            cloth->nodes[i]->isFixed = false;
+    ParticleData& p = cloth->particles;
+    for (int i = 0; i < p.size(); ++i) {
+        if (p.isFixed[i]) {
+            p.isFixed[i] = 0;
             unpinnedCount++;
         }
     }
@@ -130,110 +161,400 @@ void ImplicitNewtonIntegrator::unpin() {
 }
 
 void ImplicitNewtonIntegrator::update() {
-    double G_norm = 1.0;
+    ParticleData& p = cloth->particles;
 
-    // Newton iteration loop
-    for (int iter = 0; iter < maxIterations && G_norm > convergenceTol; iter++) {
-
-        for (int i = 0; i < cloth->nodes.size(); i++) {
-            cloth->nodes[i]->old_position = cloth->nodes[i]->position;
-        }
+    // Start of the step, kept fixed over the Newton iterations
+    for (int i = 0; i < p.size(); i++) {
+        p.old_position[i] = p.position[i];
+        start_velocity[i] = p.velocity[i];
+    }
 
-        // Compute forces
-        computeForce(TIME_STEP, gravity);
+    integrate(TIME_STEP);
 
-        // Integrate and solve
-        integrate(TIME_STEP);
+    //Handling collisions
+    for (auto collider : colliders) {
+        if (collider) {
+            collider->resolveCollision(cloth);
+        }
     }
 }
 
 void ImplicitNewtonIntegrator::computeForce(double timeStep, Vec3 gravity)
 {
-    // Reset forces
-    for (int i = 0; i < cloth->nodes.size(); i++) {
-        cloth->nodes[i]->force = Vec3(0.0, 0.0, 0.0);
-    }
+    ParticleData& p = cloth->particles;
 
-    /** Nodes **/
+    /** Springs **/
+    // Each spring only writes its own force record
 #pragma omp parallel for
-    for (int i = 0; i < cloth->nodes.size(); i++)
+    for (int i = 0; i < cloth->springs.size(); i++)
     {
-        cloth->nodes[i]->addForce(gravity * cloth->nodes[i]->mass);
+        cloth->springs.computeInternalForce(i, p);
     }
 
-    /** Springs **/
-//#pragma omp parallel for
-    for (int i = 0; i < cloth->springs.size(); i++)
+    /** Nodes **/
+    // Each node only writes its own force: gravity, then incident springs
+#pragma omp parallel for
+    for (int i = 0; i < p.size(); i++)
     {
-        cloth->springs[i]->applyInternalForce(timeStep);
+        p.force[i] = gravity * p.mass[i];
+        cloth->springs.gatherInternalForce(i, p);
     }
+}
+
+void ImplicitNewtonIntegrator::jacobianUpdate(unsigned int s, double timeStep) {
+    const ParticleData& p = cloth->particles;
+    const SpringData& springs = cloth->springs;
 
+    Vec3 diffPos = Vec3(p.position[springs.node2[s]]) - p.position[springs.node1[s]];
+	double currLen = diffPos.length();
+	Vec3 unit_vec = diffPos / currLen;
+
+    // The length term is clamped to PSD under compression, as in VBD: J
+    // stays SPD, which the LDLT path and PCG both rely on
+    Mat3x3 K_block =(Mat3x3::identity() * std::max(1 - springs.restLen[s] / currLen, 0.0)  + //k_len_term
+                     Vec3::outer(diffPos,diffPos)*springs.restLen[s] * (1 / pow(currLen, 3)) //k_dir_term
+                    ) * (-springs.hookCoef[s]);
+
+    Mat3x3 D_block = Vec3::outer(unit_vec, unit_vec) * ( - springs.dampCoef);
+
+    jacobianBlocks[s] = -K_block * timeStep * timeStep - D_block * timeStep;
 }
 
-void ImplicitNewtonIntegrator::integrate(double timeStep)
+void ImplicitNewtonIntegrator::assembleJacobian()
 {
-    /** Nodes **/
+    // J for the LDLT: the block form, copied into the existing nonzeros
+    assembleBlocks();
+    J_blocks.updateEigen(J);
+}
+
+void ImplicitNewtonIntegrator::assembleBlocks()
+{
+    // Block row n = m_n I + sum of B_s on the diagonal, -B_s towards each
+    // neighbour. Every node only writes its own block row.
+    // Pinned nodes get identity rows and columns: G is 0 there, so their
+    // delta_x is exactly 0 and they don't couple to their neighbours. The
+    // pattern stays the same, so pins can change without a new analysis.
+    ParticleData& p = cloth->particles;
+    const SpringData& springs = cloth->springs;
+
 #pragma omp parallel for
-    for (int i = 0; i < cloth->nodes.size(); i++)
-    {
-        cloth->nodes[i]->residualUpdate(timeStep);
+    for (int n = 0; n < p.size(); n++) {
+        double* row = J_blocks.blocks[J_blocks.rowOffset[n]].data;
+        std::fill(row, row + 9 * (J_blocks.rowOffset[n + 1] - J_blocks.rowOffset[n]), 0.0);
+
+        if (p.isFixed[n]) {
+            J_blocks.blocks[J_blocks.diagIndex[n]] = Mat3x3::identity();
+            continue;
+        }
+
+        // The diagonal is summed locally, it can't alias the blocks written
+        double diag[9] = { p.mass[n], 0.0, 0.0, 0.0, p.mass[n], 0.0, 0.0, 0.0, p.mass[n] };
+        for (unsigned int k = springs.adjOffset[n]; k < springs.adjOffset[n + 1]; k++) {
+            unsigned int s = springs.adjSpring[k] >> 1;
+            unsigned int other = (springs.adjSpring[k] & 1) ? springs.node1[s] : springs.node2[s];
+            const double* block = jacobianBlocks[s].data;
+            double* offDiag = J_blocks.blocks[blockSlots[k]].data;
+            for (int e = 0; e < 9; e++) {
+                diag[e] += block[e];
+                if (!p.isFixed[other])
+                    offDiag[e] -= block[e];
+            }
+        }
+        std::copy(diag, diag + 9, J_blocks.blocks[J_blocks.diagIndex[n]].data);
     }
+}
+
+void ImplicitNewtonIntegrator::computePreconditioner()
+{
+    ParticleData& p = cloth->particles;
+    const SpringData& springs = cloth->springs;
 
-    /** Springs **/
 #pragma omp parallel for
-    for (int i = 0; i < cloth->springs.size(); i++)
-    {
-        cloth->springs[i]->jacobianUpdate(timeStep);
+    for (int n = 0; n < p.size(); n++) {
+        if (p.isFixed[n]) {
+            precond[n] = Mat3x3::identity();
+            continue;
+        }
+
+        Mat3x3 diag = Mat3x3::identity() * p.mass[n];
+        for (unsigned int k = springs.adjOffset[n]; k < springs.adjOffset[n + 1]; k++) {
+            diag = diag + jacobianBlocks[springs.adjSpring[k] >> 1];
+        }
+        precond[n] = diag.inverse();
     }
+}
+
+void ImplicitNewtonIntegrator::multiply(const Eigen::VectorXd& x, Eigen::VectorXd& y)
+{
+    // y = S J x, S is the Baraff-Witkin filter, zero on pinned nodes. Once
+    // assembled, through the block SpMV
+    ParticleData& p = cloth->particles;
+    if (blocksAssembled) {
+        J_blocks.multiply(x.data(), y.data());
 
-    // Solve the linear system J * deltaX = -G
 #pragma omp parallel for
-    for (int i = 0; i < cloth->nodes.size(); ++i) {
-        G[i * 3 + 0] = cloth->nodes[i]->residual_G.x;
-        G[i * 3 + 1] = cloth->nodes[i]->residual_G.y;
-        G[i * 3 + 2] = cloth->nodes[i]->residual_G.z;
-    }
-
-    J.setZero();
-
-    for (int k = 0; k < cloth->springs.size(); ++k) {
-        auto* spring = cloth->springs[k];
-        unsigned int id1 = spring->node1->id;
-        unsigned int id2 = spring->node2->id;
-
-        for (int i = 0; i < 3; ++i) {
-            for (int j = 0; j < 3; ++j) {
-                double val = spring->jacobianBlock[i * 3 + j];
-                J.coeffRef(id1*3 + i, id1*3 + j) += val;
-                J.coeffRef(id1*3 + i, id2*3 + j) += -val;
-                J.coeffRef(id2*3 + i, id1*3 + j) += -val;
-                J.coeffRef(id2*3+ i, id2*3 + j) += val;
+        for (int n = 0; n < p.size(); n++) {
+            if (p.isFixed[n])
+                y[n * 3 + 0] = y[n * 3 + 1] = y[n * 3 + 2] = 0.0;
+        }
+        return;
+    }
+
+    // Matrix-free: row n of J is m_n x_n + sum of B_s (x_n - x_other) over
+    // its springs
+    const SpringData& springs = cloth->springs;
+
+#pragma omp parallel for
+    for (int n = 0; n < p.size(); n++) {
+        if (p.isFixed[n]) {
+            y[n * 3 + 0] = y[n * 3 + 1] = y[n * 3 + 2] = 0.0;
+            continue;
+        }
+
+        double xn[3] = { x[n * 3 + 0], x[n * 3 + 1], x[n * 3 + 2] };
+        double yn[3] = { xn[0] * p.mass[n], xn[1] * p.mass[n], xn[2] * p.mass[n] };
+        for (unsigned int k = springs.adjOffset[n]; k < springs.adjOffset[n + 1]; k++) {
+            unsigned int s = springs.adjSpring[k] >> 1;
+            unsigned int other = (springs.adjSpring[k] & 1) ? springs.node1[s] : springs.node2[s];
+            const Mat3x3& block = jacobianBlocks[s];
+            double dx[3] = { xn[0] - x[other * 3 + 0], xn[1] - x[other * 3 + 1], xn[2] - x[other * 3 + 2] };
+            for (int i = 0; i < 3; i++) {
+                yn[i] += block(i, 0) * dx[0] + block(i, 1) * dx[1] + block(i, 2) * dx[2];
             }
         }
+        y[n * 3 + 0] = yn[0];
+        y[n * 3 + 1] = yn[1];
+        y[n * 3 + 2] = yn[2];
+    }
+}
+
+void ImplicitNewtonIntegrator::applyPreconditioner(const Eigen::VectorXd& r, Eigen::VectorXd& z)
+{
+    // z = S P^-1 r with P the block diagonal of J
+    ParticleData& p = cloth->particles;
+
+#pragma omp parallel for
+    for (int n = 0; n < p.size(); n++) {
+        const Mat3x3& inv = precond[n];
+        for (int i = 0; i < 3; i++) {
+            z[n * 3 + i] = p.isFixed[n] ? 0.0 :
+                inv(i, 0) * r[n * 3 + 0] + inv(i, 1) * r[n * 3 + 1] + inv(i, 2) * r[n * 3 + 2];
+        }
+    }
+}
+
+void ImplicitNewtonIntegrator::solvePCG()
+{
+    // Modified PCG of Baraff and Witkin: pinned nodes are handled by filtering
+    // every vector with S instead of changing the matrix, so their delta_x stays 0.
+    ParticleData& p = cloth->particles;
+    blocksAssembled = false;
+    computePreconditioner();
+
+    for (int n = 0; n < p.size(); n++) {
+        if (p.isFixed[n])
+            delta_x[n * 3 + 0] = delta_x[n * 3 + 1] = delta_x[n * 3 + 2] = 0.0;
+    }
+
+    // Tolerance is relative to the right-hand side, b = -G (G is 0 on pinned nodes)
+    applyPreconditioner(G, cg_s);
+    double delta0 = G.dot(cg_s);
+
+    multiply(delta_x, cg_q);
+    cg_r = -G - cg_q;
+    applyPreconditioner(cg_r, cg_d);
+    double deltaNew = cg_r.dot(cg_d);
+
+    int iter = 0;
+    while (iter < cgMaxIterations && deltaNew > cgTolerance * cgTolerance * delta0) {
+        if (iter == cgAssembleIterations) {
+            assembleBlocks();
+            blocksAssembled = true;
+        }
+        multiply(cg_d, cg_q);
+        double alpha = deltaNew / cg_d.dot(cg_q);
+        delta_x += alpha * cg_d;
+        cg_r -= alpha * cg_q;
+
+        applyPreconditioner(cg_r, cg_s);
+        double deltaOld = deltaNew;
+        deltaNew = cg_r.dot(cg_s);
+        cg_d = cg_s + (deltaNew / deltaOld) * cg_d;
+        iter++;
+    }
+    cgIterations += iter;
+}
+
+double ImplicitNewtonIntegrator::computeResidual(double timeStep)
+{
+    // Residual G = M * (x - x_0 - v_0 * dt) - f(x, v) * dt^2 at the current
+    // positions, v = (x - x_0) / dt for the damping. Zero on fixed nodes.
+    ParticleData& p = cloth->particles;
+
+#pragma omp parallel for
+    for (int i = 0; i < p.size(); i++) {
+        if (!p.isFixed[i])
+            p.velocity[i] = (p.position[i] - p.old_position[i]) / timeStep;
+    }
+
+    computeForce(timeStep, gravity);
+
+    double norm = 0.0;
+#pragma omp parallel for reduction(+:norm)
+    for (int i = 0; i < p.size(); i++)
+    {
+        Vec3 residual;
+        if (!p.isFixed[i])
+            residual = ((p.position[i] - p.old_position[i] - start_velocity[i] * timeStep) * p.mass[i]) - (p.force[i] * (timeStep * timeStep));
+        G[i * 3 + 0] = residual.x;
+        G[i * 3 + 1] = residual.y;
+        G[i * 3 + 2] = residual.z;
+        norm += Vec3::dot(residual, residual);
     }
+    return std::sqrt(norm);
+}
 
-    J += M;
+double ImplicitNewtonIntegrator::incrementalPotential(const AlignedVector<Vec3>& x, double timeStep)
+{
+    // E(x) = 1/2 |x - x_0 - v_0 dt|_M^2 - dt^2 m g.x + dt^2 sum k/2 (|x1 - x2| - rest)^2
+    //      + dt sum c/2 (((x1 - x1_0) - (x2 - x2_0)).u)^2
+    // u is recomputed from x on every evaluation, so G is its gradient only
+    // up to the terms from u turning; those are small over one step and the
+    // line search just needs a descent slope.
+    ParticleData& p = cloth->particles;
+    const SpringData& springs = cloth->springs;
+    double h2 = timeStep * timeStep;
+
+    double inertial = 0.0;
+#pragma omp parallel for reduction(+:inertial)
+    for (int i = 0; i < p.size(); i++) {
+        if (p.isFixed[i])
+            continue;
+        Vec3 d = Vec3(x[i]) - p.old_position[i] - start_velocity[i] * timeStep;
+        inertial += p.mass[i] * (0.5 * Vec3::dot(d, d) - h2 * Vec3::dot(gravity, x[i]));
+    }
 
+    double elastic = 0.0;
+    double damping = 0.0;
+#pragma omp parallel for reduction(+:elastic, damping)
+    for (int s = 0; s < springs.size(); s++) {
+        unsigned int n1 = springs.node1[s];
+        unsigned int n2 = springs.node2[s];
+        Vec3 d = Vec3(x[n2]) - x[n1];
+        double currLen = d.length();
+        double stretch = currLen - springs.restLen[s];
+        elastic += springs.hookCoef[s] * stretch * stretch;
+
+        Vec3 moved = (Vec3(x[n2]) - p.old_position[n2]) - (Vec3(x[n1]) - p.old_position[n1]);
+        double along = Vec3::dot(moved, d) / currLen;
+        damping += springs.dampCoef * along * along;
+    }
 
-    //solver.analyzePattern(J);
-    solver.compute(J);
+    return inertial + 0.5 * h2 * elastic + 0.5 * timeStep * damping;
+}
 
-    delta_x = solver.solve(-G);
+double ImplicitNewtonIntegrator::lineSearch(double timeStep)
+{
+    // Backtracking (Armijo) on the incremental potential along delta_x. The
+    // full Newton step is usually accepted, so it costs one evaluation.
+    // Returns the accepted step, 0 when none of the tested ones decreases E.
+    ParticleData& p = cloth->particles;
+    double energy = incrementalPotential(p.position, timeStep);
+    double slope = G.dot(delta_x);
+
+    if (slope >= 0.0) {
+        // Not a descent direction (e.g. PCG stopped early): fall back to the
+        // block-Jacobi preconditioned gradient, descent since P is SPD
+        computePreconditioner();
+        applyPreconditioner(G, delta_x);
+        delta_x = -delta_x;
+        slope = G.dot(delta_x);
+        if (slope >= 0.0)
+            return 0.0;
+    }
 
-    // Update positions
+    double step = 1.0;
+    for (int ls = 0; ls < lineSearchSteps; ls++) {
 #pragma omp parallel for
-    for (int i = 0; i < cloth->nodes.size(); ++i) {
-        if (!cloth->nodes[i]->isFixed) {
-            cloth->nodes[i]->position += Vec3(delta_x[i * 3], delta_x[i * 3 + 1], delta_x[i * 3 + 2]);
-            cloth->nodes[i]->velocity = (cloth->nodes[i]->position - cloth->nodes[i]->old_position) / TIME_STEP;
+        for (int i = 0; i < p.size(); i++) {
+            trial[i] = p.position[i];
+            if (!p.isFixed[i])
+                trial[i] += Vec3(delta_x[i * 3], delta_x[i * 3 + 1], delta_x[i * 3 + 2]) * step;
         }
+        if (incrementalPotential(trial, timeStep) <= energy + 1e-4 * step * slope)
+            return step;
+        step *= 0.5;
     }
+    return 0.0;
+}
 
-	//Handling collisions
-    for (auto collider : colliders) {
-        if (collider) {
-            collider->resolveCollision(cloth);
+void ImplicitNewtonIntegrator::solveNewtonStep(double timeStep)
+{
+    /** Springs **/
+#pragma omp parallel for
+    for (int i = 0; i < cloth->springs.size(); i++)
+    {
+        jacobianUpdate(i, timeStep);
+    }
+
+    // Solve the linear system J * deltaX = -G
+
+    if (pcg) {
+        solvePCG();
+    }
+    else {
+        assembleJacobian();
+
+        solver.factorize(J);
+
+        delta_x = solver.solve(-G);
+    }
+}
+
+void ImplicitNewtonIntegrator::integrate(double timeStep)
+{
+    ParticleData& p = cloth->particles;
+
+    // Initial guess: x_0, or x_0 + v_0 dt (the last step's displacement
+    // repeated) when its incremental potential is lower
+#pragma omp parallel for
+    for (int i = 0; i < p.size(); i++) {
+        trial[i] = p.old_position[i];
+        if (!p.isFixed[i])
+            trial[i] += start_velocity[i] * timeStep;
+    }
+    if (incrementalPotential(trial, timeStep) < incrementalPotential(p.old_position, timeStep))
+        p.position = trial;
+
+    residualHistory.clear();
+    iterations = 0;
+    cgIterations = 0;
+    for (;;) {
+        double G_norm = computeResidual(timeStep);
+        residualHistory.push_back(G_norm);
+        if (iterations == maxIterations || G_norm <= convergenceTol * residualHistory[0])
+            break;
+
+        // The PCG solve starts from the last step's first correction, later
+        // corrections from zero
+        if (pcg)
+            delta_x = iterations == 0 ? delta_warm : Eigen::VectorXd::Zero(delta_x.size());
+        solveNewtonStep(timeStep);
+        if (iterations == 0)
+            delta_warm = delta_x;
+
+        double step = lineSearch(timeStep);
+        if (step == 0.0)
+            break; // No decrease along delta_x, keep x
+
+        // Update positions
+#pragma omp parallel for
+        for (int i = 0; i < p.size(); ++i) {
+            if (!p.isFixed[i])
+                p.position[i] += Vec3(delta_x[i * 3], delta_x[i * 3 + 1], delta_x[i * 3 + 2]) * step;
         }
+        iterations++;
     }
 
-}
\ No newline at end of file
+    // computeResidual left v = (x - x_0) / dt on the free nodes
+}
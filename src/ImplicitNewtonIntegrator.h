@@ -1,22 +1,38 @@
 #ifndef IMPLICIT_NEWTON_SIMULATOR_H
 #define IMPLICIT_NEWTON_SIMULATOR_H
 
+#include <string>
+#include <vector>
 #include "ClothData.h"
 #include "IClothSimulator.h"
 #include "Vectors.h"
+#include "Matrices.h"
+#include "BlockSparseMatrix.h"
 #include <Eigen/Sparse>
 
 class ImplicitNewtonIntegrator : public IClothSimulator {
 public:
-    ImplicitNewtonIntegrator(ClothData* data);
+    ImplicitNewtonIntegrator(ClothData* data, std::string method = "ImplicitNewton");
     void update() override;
 	void unpin() override;
 	std::vector<ICollider*> getColliders() override;
 	void addCollider(ICollider* col) override;
+	void restart() override;
+
+	// Newton iterations per step: stop after maxIter or once the residual
+	// norm falls below tol times the one of the initial guess
+	void setNewtonIterations(int maxIter, double tol);
+	// PCG solve of every Newton iteration (NewtonPCG): stop after maxIter or
+	// once the preconditioned residual falls below tol times the one of -G
+	void setCGIterations(int maxIter, double tol);
+	int getIterations() const { return iterations; }
+	int getCGIterations() const { return cgIterations; } // Summed over the Newton iterations of the last step
+	const std::vector<double>& getResidualHistory() const { return residualHistory; } // |G| before every iteration and at the end
 
 private:
     ClothData* cloth;
 	std::vector<ICollider*> colliders;
+	std::string method;
     Vec3 gravity;
 	double TIME_STEP;
 	double stretchingCoef;
@@ -24,18 +40,49 @@ private:
 	double shearCoef;
 
 	int maxIterations;
-	double convergenceTol;
+	double convergenceTol; // Relative to the residual norm of the initial guess
+	int lineSearchSteps; // Backtracking steps tried before the direction is rejected
+	int iterations; // Newton iterations of the last step
+	std::vector<double> residualHistory;
+
+	bool pcg; // Matrix-free preconditioned CG instead of the sparse LDLT factorization
+	int cgMaxIterations;
+	double cgTolerance; // Relative to the preconditioned norm of the right-hand side
+	int cgIterations; // PCG iterations of the last step
+	int cgAssembleIterations; // Matrix-free iterations before J is assembled into J_blocks
+	bool blocksAssembled; // J_blocks holds the J of the current solve
 	
 	Eigen::SparseMatrix<double> J;
-	Eigen::SparseMatrix<double> M;
 	Eigen::VectorXd G;
 	Eigen::SimplicialLDLT < Eigen::SparseMatrix<double >> solver;
 	Eigen::VectorXd delta_x;
+	Eigen::VectorXd delta_warm; // First correction of the last step, initial guess of the next PCG solve
+	AlignedVector<Vec3> start_velocity; // v_0 of the step, velocity is rewritten every iteration for the damping
+	AlignedVector<Vec3> trial; // Line search positions
+	AlignedVector<Mat3x3> jacobianBlocks; // One 3x3 block per spring, dF/dx for its endpoints
+	BlockSparseMatrix J_blocks; // J in 3x3 block form, for long PCG solves and copied into J for the LDLT
+	std::vector<unsigned int> blockSlots; // Block (n, other) of J_blocks per spring adjacency entry
+	AlignedVector<Mat3x3> precond; // Inverse of the 3x3 diagonal block of J per node, also the line search fallback
+	Eigen::VectorXd cg_r;
+	Eigen::VectorXd cg_s;
+	Eigen::VectorXd cg_d;
+	Eigen::VectorXd cg_q;
 
 	void initCoeff();
 	void initVars();
 	void removeZeroCoeffSpring();
 	void computeForce(double timeStep, Vec3 gravity);
+	double computeResidual(double timeStep);
+	double incrementalPotential(const AlignedVector<Vec3>& x, double timeStep);
+	double lineSearch(double timeStep);
+	void solveNewtonStep(double timeStep);
+	void jacobianUpdate(unsigned int s, double timeStep);
+	void assembleJacobian();
+	void assembleBlocks();
+	void computePreconditioner();
+	void multiply(const Eigen::VectorXd& x, Eigen::VectorXd& y);
+	void applyPreconditioner(const Eigen::VectorXd& r, Eigen::VectorXd& z);
+	void solvePCG();
 	void integrate(double timeStep);
 };
 
@@ -68,6 +68,7 @@ public:
         drawSelectModel();
 		drawMethodControl();
 		drawRestartButton();
+		drawStiffnessControl();
 		drawClothRenderMode();
         if (clothRender != nullptr && clothRender->material.hasDisplacementMap) {
             drawDisplacementController();
@@ -101,14 +102,30 @@ public:
 
 private:
     int selectedModelButton = 1;
+	int gridResolution = 40; // Nodes per side of the procedural grid
 	std::string model = "grid"; // Default model
 	std::string method = "SymplecticEuler"; // Default method
 
+    bool forceSubData = false; // Vertex streams without persistent mapping, even on GL 4.4
+
     void drawFPS() {
         calculateFPS();
 
         ImGui::Begin("GUI");
         ImGui::Text("FPS:%d", frame);
+        if (clothRender != nullptr) {
+            const ClothRender::StreamStats& stats = clothRender->stats;
+            ImGui::Text("Vertex stream: %s", clothRender->persistent ? "persistent, 3 regions" : "glBufferSubData");
+            ImGui::Text("- convert %.3f ms, upload %.3f ms, wait %.3f ms", stats.convert, stats.upload, stats.wait);
+            if (clothRender->regionsChecked > 0)
+                ImGui::Text("- readback: %d of %d regions, %s", clothRender->regionsChecked, clothRender->regionCount,
+                    clothRender->checkFailed ? "MISMATCH" : "ok");
+            if (ImGui::Checkbox("Force glBufferSubData", &forceSubData)) {
+                delete *clothRenderPtr;
+                *clothRenderPtr = new ClothRender(*clothInstancePtr, dir, basename, !forceSubData);
+                clothRender = *clothRenderPtr;
+            }
+        }
     }
 
     void drawSelectModel() {
@@ -122,7 +139,7 @@ private:
 
             if (ImGui::Button("Grid")) {
                 selectedModelButton = 1;
-				model = "grid";
+				model = "grid:" + std::to_string(gridResolution);
             }
 
             if (selected)
@@ -145,6 +162,11 @@ private:
             if (selected)
                 ImGui::PopStyleColor();
         }
+
+        if (selectedModelButton == 1) {
+            if (ImGui::SliderInt("Grid resolution", &gridResolution, 10, 1024))
+                model = "grid:" + std::to_string(gridResolution);
+        }
     }
 
     void drawRunningControl() {
@@ -230,6 +252,22 @@ private:
         }
         ImGui::SameLine();
 
+        // Button Jacobi PBD
+        {
+            bool selected = (selectedMethodButton == 6);
+            if (selected)
+                ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.2f, 0.5f, 0.8f, 1.0f));
+
+            if (ImGui::Button("Jacobi PBD")) {
+                selectedMethodButton = 6;
+                method = "JacobiPBD";
+            }
+
+            if (selected)
+                ImGui::PopStyleColor();
+        }
+        ImGui::SameLine();
+
         // Button PD
         {
             bool selected = (selectedMethodButton == 4);
@@ -263,6 +301,102 @@ private:
         }
         ImGui::SameLine();
 
+        // Button Chebyshev PBD
+        {
+            bool selected = (selectedMethodButton == 7);
+            if (selected)
+                ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.2f, 0.5f, 0.8f, 1.0f));
+
+            if (ImGui::Button("Chebyshev PBD")) {
+                selectedMethodButton = 7;
+                method = "ChebyshevPBD";
+            }
+
+            if (selected)
+                ImGui::PopStyleColor();
+        }
+        ImGui::SameLine();
+
+        // Button Chebyshev PD
+        {
+            bool selected = (selectedMethodButton == 8);
+            if (selected)
+                ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.2f, 0.5f, 0.8f, 1.0f));
+
+            if (ImGui::Button("Chebyshev PD")) {
+                selectedMethodButton = 8;
+                method = "ChebyshevPD";
+            }
+
+            if (selected)
+                ImGui::PopStyleColor();
+        }
+        ImGui::SameLine();
+
+        // Button Anderson PD
+        {
+            bool selected = (selectedMethodButton == 9);
+            if (selected)
+                ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.2f, 0.5f, 0.8f, 1.0f));
+
+            if (ImGui::Button("Anderson PD")) {
+                selectedMethodButton = 9;
+                method = "AndersonPD";
+            }
+
+            if (selected)
+                ImGui::PopStyleColor();
+        }
+        ImGui::SameLine();
+
+        // Button L-BFGS
+        {
+            bool selected = (selectedMethodButton == 10);
+            if (selected)
+                ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.2f, 0.5f, 0.8f, 1.0f));
+
+            if (ImGui::Button("L-BFGS")) {
+                selectedMethodButton = 10;
+                method = "LBFGS";
+            }
+
+            if (selected)
+                ImGui::PopStyleColor();
+        }
+        ImGui::SameLine();
+
+        // Button Newton PCG
+        {
+            bool selected = (selectedMethodButton == 11);
+            if (selected)
+                ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.2f, 0.5f, 0.8f, 1.0f));
+
+            if (ImGui::Button("Newton PCG")) {
+                selectedMethodButton = 11;
+                method = "NewtonPCG";
+            }
+
+            if (selected)
+                ImGui::PopStyleColor();
+        }
+        ImGui::SameLine();
+
+        // Button VBD
+        {
+            bool selected = (selectedMethodButton == 12);
+            if (selected)
+                ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.2f, 0.5f, 0.8f, 1.0f));
+
+            if (ImGui::Button("VBD")) {
+                selectedMethodButton = 12;
+                method = "VBD";
+            }
+
+            if (selected)
+                ImGui::PopStyleColor();
+        }
+        ImGui::SameLine();
+
     }
 
 	void drawRestartButton() {
@@ -279,7 +413,7 @@ private:
         delete *clothSpringRenderPtr;
 
         *clothInstancePtr = ClothInstance::create(model, method);
-        *clothRenderPtr = new ClothRender(*clothInstancePtr, dir, basename);
+        *clothRenderPtr = new ClothRender(*clothInstancePtr, dir, basename, !forceSubData);
         *clothSpringRenderPtr = new ClothSpringRender(*clothInstancePtr);
 
         clothInstance = *clothInstancePtr;
@@ -289,6 +423,21 @@ private:
         running = 0;
 	}
 
+    // Stiffness sliders, applied without restarting (Projective Dynamics)
+    float stretching = 10000.0f;
+    float shear = 500.0f;
+    float bending = 4000.0f;
+
+    void drawStiffnessControl() {
+        ImGui::Text("Stiffness (Projective Dynamics)");
+        bool changed = false;
+        changed |= ImGui::SliderFloat("Stretching", &stretching, 100.0f, 50000.0f);
+        changed |= ImGui::SliderFloat("Shear", &shear, 10.0f, 5000.0f);
+        changed |= ImGui::SliderFloat("Bending", &bending, 10.0f, 20000.0f);
+        if (changed)
+            clothInstance->setStiffness(stretching, shear, bending);
+    }
+
     void drawClothRenderMode() {
 		ImGui::Text("Cloth Render Mode");
 		if (ImGui::Button("Nodes")) {
@@ -358,38 +507,38 @@ private:
         ImGui::Text("Add Collider");
 
         if (ImGui::Button("Sphere")) {
-			clothInstance->addCollider(new SphereCollider);
+			clothInstance->addCollider(attachRender(new SphereCollider));
         }
 
         ImGui::SameLine();
 
         if (ImGui::Button("Box")) {
-            clothInstance->addCollider(new AABBCollider);
+            clothInstance->addCollider(attachRender(new AABBCollider));
         }
 
         ImGui::SameLine();
 
         if (ImGui::Button("Capsule")) {
 			//clothInstance->addCollider(new CapsuleCollider(randomPosition(), randomPosition()));
-			clothInstance->addCollider(new CapsuleCollider());
+			clothInstance->addCollider(attachRender(new CapsuleCollider()));
         }
 
         ImGui::SameLine();
 
         if (ImGui::Button("SweptSphere")) {
-            clothInstance->addCollider(new SweptSphereCollider);
+            clothInstance->addCollider(attachRender(new SweptSphereCollider));
         }
 
         ImGui::SameLine();
 
         if (ImGui::Button("SweptSphereTri")) {
-            clothInstance->addCollider(new SweptSphereTriCollider);
+            clothInstance->addCollider(attachRender(new SweptSphereTriCollider));
         }
 
         ImGui::SameLine();
 
         if (ImGui::Button("SphereMesh")) {
-            clothInstance->addCollider(new SphereMeshesCollider("Mesh/female_neutral_SM.txt"));
+            clothInstance->addCollider(attachRender(new SphereMeshesCollider("Mesh/female_neutral_SM.txt")));
         }
      
     }
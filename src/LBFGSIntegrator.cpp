@@ -0,0 +1,268 @@
+#include <iostream>
+#include <cmath>
+
+#include "LBFGSIntegrator.h"
+#include "ProjectiveDynamicsIntegrator.h"
+#include "ClothData.h"
+#include "Vectors.h"
+
+LBFGSIntegrator::LBFGSIntegrator(ClothData* data)
+    : cloth(data),
+    x(data->particles.size(), 3),
+    inertia(data->particles.size(), 3),
+    grad(data->particles.size(), 3),
+    x_next(data->particles.size(), 3),
+    grad_next(data->particles.size(), 3),
+    dir(data->particles.size(), 3)
+{
+    TIME_STEP = 0.01;
+    stretchingCoef = 10000.0f;
+    bendingCoef = 4000.0f;
+    shearCoef = 500.0;
+    gravity = Vec3(0.0, -9.8, 0.0);
+
+    maxIterations = 10;
+    historySize = 5;
+    convergenceTol = 1e-6;
+
+    sHistory.assign(historySize, Eigen::MatrixX3d(data->particles.size(), 3));
+    yHistory.assign(historySize, Eigen::MatrixX3d(data->particles.size(), 3));
+    rhoHistory.assign(historySize, 0.0);
+    alpha.assign(historySize, 0.0);
+    historyCount = 0;
+    historyHead = 0;
+
+    // restart() gives pins PBD's infinite mass, which would turn the
+    // inertial energy into inf * 0; pins don't move, any finite value works
+    ParticleData& p = cloth->particles;
+    mass.resize(p.size());
+    for (int i = 0; i < p.size(); i++) {
+        mass[i] = std::isfinite(p.mass[i]) ? p.mass[i] : 1.0;
+    }
+
+    initCoeff();
+    removeZeroCoeffSpring();
+    initVars();
+    cloth->springs.buildAdjacency(data->particles.size());
+
+    std::cout << "Method: " << std::endl;
+    std::cout << "- L-BFGS, history: " << historySize << ", iterations: " << maxIterations << std::endl;
+}
+
+void LBFGSIntegrator::initVars() {
+    // Same constant matrix as PD, factored once
+    ProjectiveDynamicsIntegrator::buildSystemMatrix(cloth, TIME_STEP, M, LHS);
+
+    solver.analyzePattern(LHS);
+    solver.compute(LHS);
+}
+
+void LBFGSIntegrator::initCoeff() {
+    //0: quad springs
+    //1: first diagonal spring (\)
+    //2: second diagonal spring (/)
+    //3: quad springs
+
+    for (int s = 0; s < cloth->springs.size(); ++s) {
+        if (cloth->springs.type[s] == 0) {
+            cloth->springs.hookCoef[s] = stretchingCoef;
+        }
+        else if (cloth->springs.type[s] == 1 || cloth->springs.type[s] == 2) {
+            cloth->springs.hookCoef[s] = shearCoef;
+        }
+        else if (cloth->springs.type[s] == 3) {
+            cloth->springs.hookCoef[s] = bendingCoef;
+        }
+    }
+}
+
+void LBFGSIntegrator::removeZeroCoeffSpring() {
+    // Remove springs with zero coefficient
+    cloth->springs.removeZeroCoeff();
+}
+
+void LBFGSIntegrator::unpin() {
+    ParticleData& p = cloth->particles;
+    for (int i = 0; i < p.size(); ++i) {
+        if (p.isFixed[i]) {
+            p.isFixed[i] = 0;
+        }
+    }
+}
+
+std::vector<ICollider*> LBFGSIntegrator::getColliders() {
+    return colliders;
+}
+
+void LBFGSIntegrator::addCollider(ICollider* col) {
+    colliders.push_back(col);
+}
+
+void LBFGSIntegrator::update() {
+    ParticleData& p = cloth->particles;
+
+    for (int i = 0; i < p.size(); i++) {
+        p.old_position[i] = p.position[i];
+    }
+
+    integrate(TIME_STEP);
+
+    //Handling collisions
+    for (auto collider : colliders) {
+        if (collider) {
+            collider->resolveCollision(cloth);
+        }
+    }
+}
+
+double LBFGSIntegrator::evaluate(const Eigen::MatrixX3d& xk, Eigen::MatrixX3d& g)
+{
+    // g(x) = 1/(2h^2) |x - inertia|_M^2 + sum k/2 (|x1 - x2| - rest)^2
+    ParticleData& p = cloth->particles;
+    SpringData& springs = cloth->springs;
+    double h2 = TIME_STEP * TIME_STEP;
+
+    double inertial = 0.0;
+#pragma omp parallel for reduction(+:inertial)
+    for (int i = 0; i < p.size(); i++) {
+        Vec3 d = Vec3(xk(i, 0) - inertia(i, 0), xk(i, 1) - inertia(i, 1), xk(i, 2) - inertia(i, 2));
+        inertial += mass[i] * Vec3::dot(d, d);
+
+        d = d * (mass[i] / h2);
+        g(i, 0) = d.x;
+        g(i, 1) = d.y;
+        g(i, 2) = d.z;
+    }
+
+    // Spring gradients go to the spring records and are gathered per node
+    double elastic = 0.0;
+#pragma omp parallel for reduction(+:elastic)
+    for (int j = 0; j < springs.size(); j++) {
+        int n1 = springs.node1[j];
+        int n2 = springs.node2[j];
+        Vec3 d = Vec3(xk(n1, 0) - xk(n2, 0), xk(n1, 1) - xk(n2, 1), xk(n1, 2) - xk(n2, 2));
+        double currLen = d.length();
+        double stretch = currLen - springs.restLen[j];
+        elastic += springs.hookCoef[j] * stretch * stretch;
+
+        springs.record[j] = d * (springs.hookCoef[j] * stretch / currLen);
+    }
+
+#pragma omp parallel for
+    for (int i = 0; i < p.size(); i++) {
+        Vec3 gi = springs.gatherRecord(i, Vec3(g(i, 0), g(i, 1), g(i, 2)));
+        if (p.isFixed[i]) // Fixed nodes do not take part in the minimization
+            gi = Vec3();
+        g(i, 0) = gi.x;
+        g(i, 1) = gi.y;
+        g(i, 2) = gi.z;
+    }
+
+    return 0.5 * inertial / h2 + 0.5 * elastic;
+}
+
+void LBFGSIntegrator::computeDirection()
+{
+    // Two-loop recursion, with H0^-1 applied through the prefactored PD matrix
+    Eigen::MatrixX3d q = grad;
+
+    for (int k = 0; k < historyCount; k++) {
+        int i = (historyHead - 1 - k + historySize) % historySize; // Newest first
+        alpha[i] = rhoHistory[i] * sHistory[i].cwiseProduct(q).sum();
+        q -= alpha[i] * yHistory[i];
+    }
+
+    dir = solver.solve(q);
+
+    for (int k = historyCount - 1; k >= 0; k--) {
+        int i = (historyHead - 1 - k + historySize) % historySize; // Oldest first
+        double beta = rhoHistory[i] * yHistory[i].cwiseProduct(dir).sum();
+        dir += sHistory[i] * (alpha[i] - beta);
+    }
+
+    dir = -dir;
+
+    ParticleData& p = cloth->particles;
+    for (int i = 0; i < p.size(); i++) {
+        if (p.isFixed[i])
+            dir.row(i).setZero();
+    }
+}
+
+void LBFGSIntegrator::integrate(double timeStep)
+{
+    ParticleData& p = cloth->particles;
+
+    /** Nodes **/
+    // Inertial target, also the initial guess
+#pragma omp parallel for
+    for (int i = 0; i < p.size(); i++)
+    {
+        Vec3 y = p.position[i] + p.velocity[i] * timeStep + gravity * (timeStep * timeStep);
+        if (p.isFixed[i])
+            y = p.position[i];
+        inertia(i, 0) = y.x;
+        inertia(i, 1) = y.y;
+        inertia(i, 2) = y.z;
+    }
+    x = inertia;
+
+    historyCount = 0;
+    historyHead = 0;
+    double energy = evaluate(x, grad);
+
+    for (int iter = 0; iter < maxIterations; iter++) {
+        if (grad.norm() < convergenceTol)
+            break;
+
+        computeDirection();
+
+        double slope = grad.cwiseProduct(dir).sum();
+        if (slope >= 0.0) {
+            // Not a descent direction, restart from H0
+            historyCount = 0;
+            dir = -solver.solve(grad);
+            for (int i = 0; i < p.size(); i++) {
+                if (p.isFixed[i])
+                    dir.row(i).setZero();
+            }
+            slope = grad.cwiseProduct(dir).sum();
+        }
+
+        // Backtracking line search (Armijo), the full step is usually accepted
+        double step = 1.0;
+        double nextEnergy = 0.0;
+        bool accepted = false;
+        for (int ls = 0; ls < 10 && !accepted; ls++) {
+            x_next = x + step * dir;
+            nextEnergy = evaluate(x_next, grad_next);
+            accepted = nextEnergy <= energy + 1e-4 * step * slope;
+            step *= 0.5;
+        }
+        if (!accepted)
+            break; // No decrease along dir, keep x
+
+        // Curvature pair
+        int i = historyHead;
+        sHistory[i] = x_next - x;
+        yHistory[i] = grad_next - grad;
+        double sy = sHistory[i].cwiseProduct(yHistory[i]).sum();
+        if (sy > 1e-12) {
+            rhoHistory[i] = 1.0 / sy;
+            historyHead = (historyHead + 1) % historySize;
+            if (historyCount < historySize) historyCount++;
+        }
+
+        x.swap(x_next);
+        grad.swap(grad_next);
+        energy = nextEnergy;
+    }
+
+#pragma omp parallel for
+    for (int i = 0; i < p.size(); ++i) {
+        if (!p.isFixed[i]) {
+            p.position[i] = Vec3(x(i, 0), x(i, 1), x(i, 2));
+            p.velocity[i] = (p.position[i] - p.old_position[i]) / timeStep;
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef LBFGS_INTEGRATOR_H
+#define LBFGS_INTEGRATOR_H
+
+#include <vector>
+#include "ClothData.h"
+#include "IClothSimulator.h"
+#include "Vectors.h"
+#include "ICollider.h"
+#include <Eigen/Sparse>
+#include <Eigen/Dense>
+
+// Implicit Euler as energy minimization, solved with L-BFGS. The initial
+// Hessian is the constant, prefactored PD matrix M / h^2 + L (Liu et al. 2017),
+// so no numeric factorization happens per step.
+class LBFGSIntegrator : public IClothSimulator {
+public:
+	LBFGSIntegrator(ClothData* data);
+	void update() override;
+	void unpin() override;
+	std::vector<ICollider*> getColliders() override;
+	void addCollider(ICollider* col) override;
+
+private:
+	ClothData* cloth;
+	std::vector<ICollider*> colliders;
+	Vec3 gravity;
+	double TIME_STEP;
+	double stretchingCoef;
+	double bendingCoef;
+	double shearCoef;
+	std::vector<double> mass; // Per node, finite for pins too
+
+	int maxIterations;
+	int historySize;
+	double convergenceTol;
+
+	Eigen::SparseMatrix<double> LHS;
+	Eigen::SparseMatrix<double> M;
+	Eigen::SimplicialLLT < Eigen::SparseMatrix<double >> solver;
+
+	Eigen::MatrixX3d x;       // Current iterate, one column per coordinate
+	Eigen::MatrixX3d inertia; // x_n + h v_n + h^2 M^-1 f_ext
+	Eigen::MatrixX3d grad;
+	Eigen::MatrixX3d x_next;
+	Eigen::MatrixX3d grad_next;
+	Eigen::MatrixX3d dir;
+
+	// Ring buffer of the last historySize (s, y) pairs
+	std::vector<Eigen::MatrixX3d> sHistory;
+	std::vector<Eigen::MatrixX3d> yHistory;
+	std::vector<double> rhoHistory;
+	std::vector<double> alpha;
+	int historyCount;
+	int historyHead;
+
+	void initCoeff();
+	void initVars();
+	void removeZeroCoeffSpring();
+	double evaluate(const Eigen::MatrixX3d& xk, Eigen::MatrixX3d& g);
+	void computeDirection();
+	void integrate(double timeStep);
+};
+
+#endif
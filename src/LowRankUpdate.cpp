@@ -0,0 +1,110 @@
+#include "LowRankUpdate.h"
+
+LowRankUpdate::LowRankUpdate() : solver(nullptr), size(0), maxRank(0), refactorColumns(0.0), dirty(false) {}
+
+void LowRankUpdate::setSolver(const Solver* s, int n, int capacity)
+{
+	solver = s;
+	size = n;
+	maxRank = capacity;
+	clear();
+
+	// Left-looking factorization: column j costs about nnz(L_j)^2 flops, a
+	// solve 2 nnz(L). The pattern is fixed, so this holds for every refactor.
+	const Eigen::SparseMatrix<double>& L = solver->matrixL().nestedExpression();
+	double factorFlops = 0.0;
+	for (int j = 0; j < L.outerSize(); j++) {
+		double count = L.outerIndexPtr()[j + 1] - L.outerIndexPtr()[j];
+		factorFlops += count * count;
+	}
+	refactorColumns = L.nonZeros() > 0 ? factorFlops / (2.0 * L.nonZeros()) : 0.0;
+}
+
+void LowRankUpdate::clear()
+{
+	nodes.clear();
+	deltas.clear();
+	slot.assign(size, -1);
+	dirty = false;
+}
+
+bool LowRankUpdate::set(unsigned int node, double delta)
+{
+	if (delta == 0.0) {
+		remove(node);
+		return true;
+	}
+	if (contains(node)) {
+		// Same column, only the capacitance changes
+		if (deltas[slot[node]] != delta) {
+			deltas[slot[node]] = delta;
+			dirty = true;
+		}
+		return true;
+	}
+	if (rank() >= maxRank)
+		return false;
+
+	if (Z.cols() != maxRank)
+		Z.resize(size, maxRank);
+
+	int j = rank();
+	nodes.push_back(node);
+	deltas.push_back(delta);
+	slot[node] = j;
+
+	Eigen::VectorXd e = Eigen::VectorXd::Zero(size);
+	e[node] = 1.0;
+	Z.col(j) = solver->solve(e);
+	dirty = true;
+	return true;
+}
+
+void LowRankUpdate::remove(unsigned int node)
+{
+	if (!contains(node))
+		return;
+
+	// Move the last column into the freed one
+	int j = slot[node];
+	int last = rank() - 1;
+	if (j != last) {
+		nodes[j] = nodes[last];
+		deltas[j] = deltas[last];
+		slot[nodes[j]] = j;
+		Z.col(j) = Z.col(last);
+	}
+	nodes.pop_back();
+	deltas.pop_back();
+	slot[node] = -1;
+	dirty = true;
+}
+
+void LowRankUpdate::factorCapacitance()
+{
+	int k = rank();
+	Eigen::MatrixXd K(k, k);
+	for (int i = 0; i < k; i++) {
+		for (int j = 0; j < k; j++)
+			K(i, j) = Z(nodes[i], j);
+		K(i, i) += 1.0 / deltas[i];
+	}
+	capacitance.compute(K);
+	dirty = false;
+}
+
+void LowRankUpdate::apply(Eigen::MatrixX3d& x)
+{
+	if (nodes.empty())
+		return;
+	if (dirty)
+		factorCapacitance();
+
+	int k = rank();
+	residual.resize(k, 3);
+	for (int j = 0; j < k; j++)
+		residual.row(j) = x.row(nodes[j]);
+
+	correction = capacitance.solve(residual);
+	x.noalias() -= Z.leftCols(k) * correction;
+}
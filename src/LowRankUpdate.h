@@ -0,0 +1,51 @@
+#ifndef LOW_RANK_UPDATE_H
+#define LOW_RANK_UPDATE_H
+
+#include <vector>
+#include <Eigen/Sparse>
+#include <Eigen/Dense>
+
+// Diagonal changes d_i added to a prefactored SPD system A without touching
+// its factorization (Sherman-Morrison-Woodbury):
+//   (A + U D U^T)^-1 b = y - Z K^-1 y_I,  y = A^-1 b,  Z = A^-1 U,  K = D^-1 + Z_I
+// U selects the changed nodes I. A new node costs one solve with A, removing
+// it drops its column; a negative d takes weight out of A. The rank is capped
+// (Z is n x capacity): past it, or when the new columns would cost more than
+// a refactor, the caller folds the changes into A and refactors instead.
+class LowRankUpdate {
+public:
+	typedef Eigen::SimplicialLLT<Eigen::SparseMatrix<double>> Solver;
+
+	LowRankUpdate();
+	void setSolver(const Solver* s, int n, int capacity);
+
+	bool set(unsigned int node, double delta); // 0 removes the node, false when full
+	void clear();
+	bool contains(unsigned int node) const { return node < slot.size() && slot[node] >= 0; }
+	double delta(unsigned int node) const { return contains(node) ? deltas[slot[node]] : 0.0; }
+	int rank() const { return (int)nodes.size(); }
+	int capacity() const { return maxRank; }
+	double refactorCost() const { return refactorColumns; }
+
+	void apply(Eigen::MatrixX3d& x); // x = A^-1 b on input, (A + U D U^T)^-1 b on output
+
+private:
+	const Solver* solver;
+	int size;
+	int maxRank;
+	double refactorColumns; // Numeric refactorization cost, in single column solves
+
+	std::vector<unsigned int> nodes;
+	std::vector<double> deltas;
+	std::vector<int> slot; // Column of every node in Z, -1 if unchanged
+	Eigen::MatrixXd Z; // First rank() columns used
+	Eigen::MatrixX3d residual;
+	Eigen::MatrixX3d correction;
+	Eigen::PartialPivLU<Eigen::MatrixXd> capacitance; // Indefinite once weight is taken out
+	bool dirty;
+
+	void remove(unsigned int node);
+	void factorCapacitance();
+};
+
+#endif
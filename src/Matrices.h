@@ -73,6 +73,21 @@ struct Mat3x3 {
         return data[index];
     }
 
+    Mat3x3 inverse() const {
+        Mat3x3 result;
+        result.data[0] = data[4] * data[8] - data[5] * data[7];
+        result.data[1] = data[2] * data[7] - data[1] * data[8];
+        result.data[2] = data[1] * data[5] - data[2] * data[4];
+        result.data[3] = data[5] * data[6] - data[3] * data[8];
+        result.data[4] = data[0] * data[8] - data[2] * data[6];
+        result.data[5] = data[2] * data[3] - data[0] * data[5];
+        result.data[6] = data[3] * data[7] - data[4] * data[6];
+        result.data[7] = data[1] * data[6] - data[0] * data[7];
+        result.data[8] = data[0] * data[4] - data[1] * data[3];
+        double det = data[0] * result.data[0] + data[1] * result.data[3] + data[2] * result.data[6];
+        return result * (1.0 / det);
+    }
+
     static Mat3x3 identity() {
         return Mat3x3{
             1.0, 0.0, 0.0,
@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+#include "NodeOrdering.h"
+
+NodeOrdering::Type NodeOrdering::fromString(const std::string& name)
+{
+	if (name == "RCM") return RCM;
+	if (name == "ND") return NESTED_DISSECTION;
+	if (name == "Morton") return MORTON;
+	if (name != "None")
+		std::cout << "ERROR::NodeOrdering : Unsupported ordering: " << name << std::endl;
+	return NONE;
+}
+
+const char* NodeOrdering::name(Type t)
+{
+	switch (t) {
+	case RCM: return "RCM";
+	case NESTED_DISSECTION: return "ND";
+	case MORTON: return "Morton";
+	default: return "None";
+	}
+}
+
+std::vector<unsigned int> NodeOrdering::compute(Type t, const ParticleData& particles, const SpringData& springs)
+{
+	switch (t) {
+	case RCM: return reverseCuthillMcKee(buildAdjacency(springs, particles.size()));
+	case NESTED_DISSECTION: return nestedDissection(particles, buildAdjacency(springs, particles.size()));
+	case MORTON: return morton(particles);
+	default: break;
+	}
+
+	std::vector<unsigned int> order(particles.size());
+	for (unsigned int n = 0; n < order.size(); n++)
+		order[n] = n;
+	return order;
+}
+
+NodeOrdering::Adjacency NodeOrdering::buildAdjacency(const SpringData& springs, size_t nodeCount)
+{
+	Adjacency adj(nodeCount);
+	for (size_t s = 0; s < springs.size(); s++) {
+		adj[springs.node1[s]].push_back(springs.node2[s]);
+		adj[springs.node2[s]].push_back(springs.node1[s]);
+	}
+	for (auto& neighbours : adj) {
+		std::sort(neighbours.begin(), neighbours.end());
+		neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+	}
+	return adj;
+}
+
+std::vector<unsigned int> NodeOrdering::reverseCuthillMcKee(const Adjacency& adj)
+{
+	const unsigned int n = (unsigned int)adj.size();
+	std::vector<unsigned int> order;
+	order.reserve(n);
+	std::vector<char> visited(n, 0);
+	std::vector<unsigned int> level(n);
+
+	auto byDegree = [&](unsigned int a, unsigned int b) {
+		return adj[a].size() < adj[b].size() || (adj[a].size() == adj[b].size() && a < b);
+	};
+
+	// Breadth first from start, neighbours by increasing degree. Returns the
+	// index in order where the last level begins.
+	auto bfs = [&](unsigned int start, std::vector<unsigned int>& out) {
+		size_t first = out.size();
+		size_t lastLevel = first;
+		out.push_back(start);
+		visited[start] = 1;
+		level[start] = 0;
+		std::vector<unsigned int> next;
+		for (size_t i = first; i < out.size(); i++) {
+			unsigned int v = out[i];
+			if (level[v] != level[out[lastLevel]])
+				lastLevel = i;
+			next.clear();
+			for (unsigned int w : adj[v]) {
+				if (!visited[w]) {
+					visited[w] = 1;
+					level[w] = level[v] + 1;
+					next.push_back(w);
+				}
+			}
+			std::sort(next.begin(), next.end(), byDegree);
+			out.insert(out.end(), next.begin(), next.end());
+		}
+		return lastLevel;
+	};
+
+	std::vector<unsigned int> component;
+	for (unsigned int seed = 0; seed < n; seed++) {
+		if (visited[seed])
+			continue;
+
+		// Pseudo-peripheral start node: restart from the smallest degree node
+		// of the last level while the eccentricity keeps growing
+		unsigned int start = seed;
+		unsigned int depth = 0;
+		for (int pass = 0; pass < 8; pass++) {
+			component.clear();
+			size_t lastLevel = bfs(start, component);
+			unsigned int newDepth = level[component.back()];
+			unsigned int candidate = *std::min_element(component.begin() + lastLevel, component.end(), byDegree);
+			for (unsigned int v : component)
+				visited[v] = 0;
+			if (pass > 0 && newDepth <= depth)
+				break;
+			depth = newDepth;
+			start = candidate;
+		}
+
+		bfs(start, order);
+	}
+
+	std::reverse(order.begin(), order.end());
+	return order;
+}
+
+std::vector<unsigned int> NodeOrdering::nestedDissection(const ParticleData& particles, const Adjacency& adj)
+{
+	std::vector<unsigned int> nodes(particles.size());
+	for (unsigned int n = 0; n < nodes.size(); n++)
+		nodes[n] = n;
+
+	std::vector<unsigned int> order;
+	order.reserve(nodes.size());
+	std::vector<unsigned int> region(nodes.size(), 0);
+	unsigned int regions = 1;
+	dissect(nodes, particles, adj, region, regions, order);
+	return order;
+}
+
+void NodeOrdering::dissect(std::vector<unsigned int>& nodes, const ParticleData& particles, const Adjacency& adj,
+                           std::vector<unsigned int>& region, unsigned int& regions, std::vector<unsigned int>& order)
+{
+	if (nodes.size() <= 32) {
+		order.insert(order.end(), nodes.begin(), nodes.end());
+		return;
+	}
+
+	// Split at the median along the longest side of the rest bounding box
+	Vec3 lo = particles.initial_position[nodes[0]];
+	Vec3 hi = lo;
+	for (unsigned int v : nodes) {
+		const Vec3& p = particles.initial_position[v];
+		lo = Vec3(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+		hi = Vec3(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+	}
+	Vec3 extent = hi - lo;
+	int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+	auto coord = [&](unsigned int v) {
+		const Vec3& p = particles.initial_position[v];
+		return axis == 0 ? p.x : (axis == 1 ? p.y : p.z);
+	};
+
+	size_t half = nodes.size() / 2;
+	std::nth_element(nodes.begin(), nodes.begin() + half, nodes.end(), [&](unsigned int a, unsigned int b) {
+		return coord(a) < coord(b) || (coord(a) == coord(b) && a < b);
+	});
+
+	unsigned int left = regions++;
+	unsigned int right = regions++;
+	for (size_t i = 0; i < nodes.size(); i++)
+		region[nodes[i]] = i < half ? left : right;
+
+	// Separator: right side nodes touching the left side
+	std::vector<unsigned int> a(nodes.begin(), nodes.begin() + half);
+	std::vector<unsigned int> b, separator;
+	for (size_t i = half; i < nodes.size(); i++) {
+		unsigned int v = nodes[i];
+		bool boundary = false;
+		for (unsigned int w : adj[v]) {
+			if (region[w] == left) {
+				boundary = true;
+				break;
+			}
+		}
+		(boundary ? separator : b).push_back(v);
+	}
+
+	std::vector<unsigned int>().swap(nodes);
+	dissect(a, particles, adj, region, regions, order);
+	dissect(b, particles, adj, region, regions, order);
+	std::sort(separator.begin(), separator.end());
+	order.insert(order.end(), separator.begin(), separator.end());
+}
+
+std::vector<unsigned int> NodeOrdering::morton(const ParticleData& particles)
+{
+	const size_t n = particles.size();
+	std::vector<unsigned int> order(n);
+	if (n == 0)
+		return order;
+
+	Vec3 lo = particles.initial_position[0];
+	Vec3 hi = lo;
+	for (size_t v = 0; v < n; v++) {
+		const Vec3& p = particles.initial_position[v];
+		lo = Vec3(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+		hi = Vec3(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+	}
+	double extent = std::max(hi.x - lo.x, std::max(hi.y - lo.y, hi.z - lo.z));
+	double scale = extent > 0.0 ? 2097151.0 / extent : 0.0; // 21 bits per axis
+
+	// Spread the 21 bits of x so that two zero bits follow each of them
+	auto spread = [](std::uint64_t x) {
+		x &= 0x1fffff;
+		x = (x | x << 32) & 0x1f00000000ffffULL;
+		x = (x | x << 16) & 0x1f0000ff0000ffULL;
+		x = (x | x << 8) & 0x100f00f00f00f00fULL;
+		x = (x | x << 4) & 0x10c30c30c30c30c3ULL;
+		x = (x | x << 2) & 0x1249249249249249ULL;
+		return x;
+	};
+
+	std::vector<std::pair<std::uint64_t, unsigned int>> keys(n);
+	for (size_t v = 0; v < n; v++) {
+		const Vec3& p = particles.initial_position[v];
+		std::uint64_t x = (std::uint64_t)((p.x - lo.x) * scale);
+		std::uint64_t y = (std::uint64_t)((p.y - lo.y) * scale);
+		std::uint64_t z = (std::uint64_t)((p.z - lo.z) * scale);
+		keys[v] = std::make_pair(spread(x) | spread(y) << 1 | spread(z) << 2, (unsigned int)v);
+	}
+	std::sort(keys.begin(), keys.end());
+
+	for (size_t i = 0; i < n; i++)
+		order[i] = keys[i].second;
+	return order;
+}
+
+unsigned int NodeOrdering::bandwidth(const SpringData& springs)
+{
+	unsigned int band = 0;
+	for (size_t s = 0; s < springs.size(); s++) {
+		unsigned int n1 = springs.node1[s];
+		unsigned int n2 = springs.node2[s];
+		band = std::max(band, n1 > n2 ? n1 - n2 : n2 - n1);
+	}
+	return band;
+}
+
+size_t NodeOrdering::factorNonZeros(const SpringData& springs, size_t nodeCount)
+{
+	// Symbolic Cholesky of the spring graph's pattern (the PD system per
+	// coordinate) in the current numbering, without any fill-reducing
+	// permutation: every row k walks the elimination tree up from its
+	// neighbours i < k, each newly reached column gains a nonzero in row k.
+	Adjacency adj = buildAdjacency(springs, nodeCount);
+	std::vector<int> parent(nodeCount, -1);
+	std::vector<size_t> tag(nodeCount);
+	size_t nonZeros = nodeCount;
+	for (size_t k = 0; k < nodeCount; k++) {
+		tag[k] = k;
+		for (unsigned int i : adj[k]) {
+			if (i >= k)
+				break;
+			for (; tag[i] != k; i = parent[i]) {
+				if (parent[i] == -1)
+					parent[i] = (int)k;
+				nonZeros++;
+				tag[i] = k;
+			}
+		}
+	}
+	return nonZeros;
+}
@@ -0,0 +1,40 @@
+#ifndef NODE_ORDERING_H
+#define NODE_ORDERING_H
+
+#include <string>
+#include <vector>
+#include "ParticleData.h"
+#include "SpringData.h"
+
+// Node renumbering for Cholesky fill-in (PD, Newton) and for cache locality
+// of the spring loops. An order lists the old node index of every new index.
+class NodeOrdering {
+public:
+    enum Type {
+        NONE,              // Keep the build order
+        RCM,               // Reverse Cuthill-McKee, small bandwidth
+        NESTED_DISSECTION, // Geometric bisection of the rest shape, separators last
+        MORTON             // Z-order curve on the rest positions
+    };
+
+    static Type fromString(const std::string& name);
+    static const char* name(Type t);
+
+    static std::vector<unsigned int> compute(Type t, const ParticleData& particles, const SpringData& springs);
+
+    // Quality of the current numbering
+    static unsigned int bandwidth(const SpringData& springs);
+    static size_t factorNonZeros(const SpringData& springs, size_t nodeCount);
+
+private:
+    typedef std::vector<std::vector<unsigned int>> Adjacency;
+
+    static Adjacency buildAdjacency(const SpringData& springs, size_t nodeCount);
+    static std::vector<unsigned int> reverseCuthillMcKee(const Adjacency& adj);
+    static std::vector<unsigned int> nestedDissection(const ParticleData& particles, const Adjacency& adj);
+    static void dissect(std::vector<unsigned int>& nodes, const ParticleData& particles, const Adjacency& adj,
+                        std::vector<unsigned int>& region, unsigned int& regions, std::vector<unsigned int>& order);
+    static std::vector<unsigned int> morton(const ParticleData& particles);
+};
+
+#endif
@@ -0,0 +1,411 @@
+#include <omp.h>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include "ObjLoader.h"
+#include "MappedFile.h"
+
+namespace {
+
+enum Record { OTHER, POSITION, TEXCOORD, FACE };
+
+const uint64_t EMPTY = ~(uint64_t)0; // Free IndexTable slot, not a valid packed key
+
+// Part of the buffer starting at a line start. Counts come from the first
+// pass, bases are the prefix sums of the counts of the chunks before.
+struct Chunk {
+    const char* begin;
+    const char* end;
+    size_t lines, positions, texcoords, triangles;
+    size_t lineBase, positionBase, texcoordBase, triangleBase;
+    size_t badLine; // 0 when every record parsed
+};
+
+inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+inline const char* lineEnd(const char* p, const char* end)
+{
+    const char* eol = (const char*)memchr(p, '\n', end - p);
+    return eol ? eol : end;
+}
+
+inline void skipBlanks(const char*& p, const char* end)
+{
+    while (p < end && isBlank(*p))
+        p++;
+}
+
+// Consumes the record keyword of the line at p
+Record recordType(const char*& p, const char* end)
+{
+    skipBlanks(p, end);
+    if (end - p >= 2 && p[0] == 'v' && isBlank(p[1])) {
+        p += 1;
+        return POSITION;
+    }
+    if (end - p >= 3 && p[0] == 'v' && p[1] == 't' && isBlank(p[2])) {
+        p += 2;
+        return TEXCOORD;
+    }
+    if (end - p >= 2 && p[0] == 'f' && isBlank(p[1])) {
+        p += 1;
+        return FACE;
+    }
+    return OTHER;
+}
+
+int countCorners(const char* p, const char* end)
+{
+    int count = 0;
+    for (;;) {
+        skipBlanks(p, end);
+        if (p == end || *p == '#')
+            return count;
+        count++;
+        while (p < end && !isBlank(*p))
+            p++;
+    }
+}
+
+bool parseInt(const char*& p, const char* end, long long& value)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = (*p++ == '-');
+    if (p == end || !isDigit(*p))
+        return false;
+
+    long long v = 0;
+    while (p < end && isDigit(*p))
+        v = v * 10 + (*p++ - '0');
+    value = negative ? -v : v;
+    return true;
+}
+
+// Decimal and exponent notation, the first 19 significant digits exact in a
+// 64 bit mantissa, then a single scaling by a power of ten
+bool parseDouble(const char*& p, const char* end, double& value)
+{
+    static const double POW10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    skipBlanks(p, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = (*p++ == '-');
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any = false;
+    for (; p < end && isDigit(*p); p++, any = true) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += (mantissa != 0);
+        }
+        else
+            exponent++;
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && isDigit(*p); p++, any = true) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += (mantissa != 0);
+                exponent--;
+            }
+        }
+    }
+    if (!any)
+        return false;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        long long e;
+        p++;
+        if (!parseInt(p, end, e))
+            return false;
+        exponent += (int)std::max(-400LL, std::min(400LL, e));
+    }
+
+    double v = (double)mantissa;
+    if (exponent < 0 && exponent >= -22)
+        v /= POW10[-exponent];
+    else if (exponent > 0 && exponent <= 22)
+        v *= POW10[exponent];
+    else if (exponent != 0)
+        v *= std::pow(10.0, exponent);
+    value = negative ? -v : v;
+    return true;
+}
+
+// A number that is a whole token. p only moves on success.
+inline bool parseField(const char*& p, const char* end, double& value)
+{
+    const char* q = p;
+    if (!parseDouble(q, end, value) || !(q == end || isBlank(*q) || *q == '#'))
+        return false;
+    p = q;
+    return true;
+}
+
+// 1-based, or negative relative to count. Returns the 0-based index, -1 if invalid.
+inline long long resolveIndex(long long index, size_t count, size_t total)
+{
+    long long i = index > 0 ? index - 1 : (long long)count + index;
+    return (index != 0 && i >= 0 && i < (long long)total) ? i : -1;
+}
+
+// Open addressing table from 64 bit keys to indices, linear probing,
+// kept under half full
+class IndexTable {
+public:
+    explicit IndexTable(size_t expected) : count(0)
+    {
+        bits = 4;
+        while (((size_t)1 << bits) < expected * 2)
+            bits++;
+        keys.assign((size_t)1 << bits, EMPTY);
+        values.resize(keys.size());
+    }
+
+    // Index stored for key, or value after storing it if key is new
+    unsigned int insert(uint64_t key, unsigned int value, bool& inserted)
+    {
+        if (2 * (count + 1) > keys.size())
+            grow();
+        size_t mask = keys.size() - 1;
+        size_t slot = slotOf(key);
+        while (keys[slot] != EMPTY) {
+            if (keys[slot] == key) {
+                inserted = false;
+                return values[slot];
+            }
+            slot = (slot + 1) & mask;
+        }
+        keys[slot] = key;
+        values[slot] = value;
+        count++;
+        inserted = true;
+        return value;
+    }
+
+private:
+    std::vector<uint64_t> keys;
+    std::vector<unsigned int> values;
+    size_t count;
+    int bits;
+
+    size_t slotOf(uint64_t key) const
+    {
+        // Fibonacci hashing, the high bits of the product are the best mixed
+        return (size_t)((key * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+    }
+
+    void grow()
+    {
+        std::vector<uint64_t> oldKeys;
+        std::vector<unsigned int> oldValues;
+        oldKeys.swap(keys);
+        oldValues.swap(values);
+        bits++;
+        keys.assign((size_t)1 << bits, EMPTY);
+        values.resize(keys.size());
+
+        size_t mask = keys.size() - 1;
+        for (size_t i = 0; i < oldKeys.size(); i++) {
+            if (oldKeys[i] == EMPTY)
+                continue;
+            size_t slot = slotOf(oldKeys[i]);
+            while (keys[slot] != EMPTY)
+                slot = (slot + 1) & mask;
+            keys[slot] = oldKeys[i];
+            values[slot] = oldValues[i];
+        }
+    }
+};
+
+void countRecords(Chunk& chunk)
+{
+    chunk.lines = chunk.positions = chunk.texcoords = chunk.triangles = 0;
+    for (const char* p = chunk.begin; p < chunk.end; ) {
+        const char* eol = lineEnd(p, chunk.end);
+        switch (recordType(p, eol)) {
+        case POSITION: chunk.positions++; break;
+        case TEXCOORD: chunk.texcoords++; break;
+        case FACE: chunk.triangles += (countCorners(p, eol) == 3); break;
+        default: break;
+        }
+        chunk.lines++;
+        p = eol < chunk.end ? eol + 1 : chunk.end;
+    }
+}
+
+// Writes the records of the chunk at its bases. Corners are packed as
+// position << 32 | (texcoord + 1), texcoord + 1 = 0 for none.
+void parseRecords(Chunk& chunk, size_t positionTotal, size_t texcoordTotal,
+                  std::vector<Vec3>& positions, std::vector<Vec2>& texcoords, std::vector<uint64_t>& corners)
+{
+    size_t line = chunk.lineBase;
+    size_t v = chunk.positionBase;
+    size_t vt = chunk.texcoordBase;
+    size_t t = chunk.triangleBase;
+    chunk.badLine = 0;
+
+    for (const char* p = chunk.begin; p < chunk.end; line++) {
+        const char* eol = lineEnd(p, chunk.end);
+        Record record = recordType(p, eol);
+        bool ok = true;
+
+        if (record == POSITION) {
+            // Optional w, or vertex colors, after x y z are ignored
+            Vec3& x = positions[v++];
+            ok = parseField(p, eol, x.x) && parseField(p, eol, x.y) && parseField(p, eol, x.z);
+        }
+        else if (record == TEXCOORD) {
+            Vec2& uv = texcoords[vt++];
+            ok = parseField(p, eol, uv.x);
+            if (ok && !parseField(p, eol, uv.y))
+                uv.y = 0.0; // v is optional
+        }
+        else if (record == FACE && countCorners(p, eol) == 3) {
+            uint64_t* corner = &corners[3 * t++];
+            for (int c = 0; c < 3 && ok; c++) {
+                long long vIndex, vtIndex = -1, raw;
+                skipBlanks(p, eol);
+                ok = parseInt(p, eol, raw) && (vIndex = resolveIndex(raw, v, positionTotal)) >= 0;
+                if (ok && p < eol && *p == '/') {
+                    p++;
+                    if (p < eol && *p != '/') {
+                        ok = parseInt(p, eol, raw);
+                        vtIndex = resolveIndex(raw, vt, texcoordTotal); // Out of range reads as no texcoord
+                    }
+                }
+                while (p < eol && !isBlank(*p))
+                    p++; // Normal index, unused
+                if (ok)
+                    corner[c] = ((uint64_t)vIndex << 32) | (uint64_t)(vtIndex + 1);
+            }
+        }
+
+        if (!ok && chunk.badLine == 0)
+            chunk.badLine = line + 1;
+        p = eol < chunk.end ? eol + 1 : chunk.end;
+    }
+}
+
+}
+
+bool ObjLoader::load(const std::string& path, ObjMesh& mesh, std::string& error)
+{
+    MappedFile file;
+    if (!file.open(path)) {
+        error = "can't open " + path;
+        return false;
+    }
+    return parse(file.data(), file.size(), mesh, error);
+}
+
+bool ObjLoader::parse(const char* data, size_t size, ObjMesh& mesh, std::string& error)
+{
+    mesh = ObjMesh();
+
+    // A few chunks per thread, none smaller than 64 KB
+    const size_t MIN_CHUNK = 1 << 16;
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(omp_get_max_threads() * 4, size / MIN_CHUNK));
+    std::vector<Chunk> chunks(chunkCount);
+    const char* end = data + size;
+    for (size_t i = 0; i < chunkCount; i++) {
+        const char* begin = data + size * i / chunkCount;
+        if (i > 0) {
+            begin = std::max(begin, chunks[i - 1].begin);
+            if (begin > data && begin[-1] != '\n')
+                begin = std::min(lineEnd(begin, end) + 1, end);
+            chunks[i - 1].end = begin;
+        }
+        chunks[i].begin = begin;
+        chunks[i].end = end;
+    }
+
+    /** Pass 1: record counts per chunk **/
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int)chunkCount; i++)
+        countRecords(chunks[i]);
+
+    size_t lines = 0, positionTotal = 0, texcoordTotal = 0, triangleTotal = 0;
+    for (Chunk& chunk : chunks) {
+        chunk.lineBase = lines;
+        chunk.positionBase = positionTotal;
+        chunk.texcoordBase = texcoordTotal;
+        chunk.triangleBase = triangleTotal;
+        lines += chunk.lines;
+        positionTotal += chunk.positions;
+        texcoordTotal += chunk.texcoords;
+        triangleTotal += chunk.triangles;
+    }
+    if (positionTotal >= 0xFFFFFFFFu || texcoordTotal >= 0xFFFFFFFEu || 3 * triangleTotal >= 0xFFFFFFFFu) {
+        error = "too many records";
+        return false;
+    }
+
+    /** Pass 2: records written in place **/
+    std::vector<Vec3> positions(positionTotal);
+    std::vector<Vec2> texcoords(texcoordTotal);
+    std::vector<uint64_t> corners(3 * triangleTotal);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int)chunkCount; i++)
+        parseRecords(chunks[i], positionTotal, texcoordTotal, positions, texcoords, corners);
+
+    for (const Chunk& chunk : chunks) {
+        if (chunk.badLine != 0) {
+            error = "malformed record at line " + std::to_string(chunk.badLine);
+            return false;
+        }
+    }
+
+    /** Weld: one node per distinct corner, in order of first use **/
+    std::vector<uint64_t> nodeCorner;
+    nodeCorner.reserve(positionTotal + positionTotal / 8);
+    mesh.triangles.resize(corners.size());
+    IndexTable nodeTable(positionTotal + positionTotal / 8);
+    for (size_t c = 0; c < corners.size(); c++) {
+        bool inserted;
+        mesh.triangles[c] = nodeTable.insert(corners[c], (unsigned int)nodeCorner.size(), inserted);
+        if (inserted)
+            nodeCorner.push_back(corners[c]);
+    }
+
+    mesh.position.resize(nodeCorner.size());
+    mesh.texCoord.resize(nodeCorner.size());
+#pragma omp parallel for
+    for (int n = 0; n < (int)nodeCorner.size(); n++) {
+        uint64_t vt = nodeCorner[n] & 0xFFFFFFFFu;
+        mesh.position[n] = positions[nodeCorner[n] >> 32];
+        mesh.texCoord[n] = vt ? texcoords[vt - 1] : Vec2();
+    }
+
+    /** Edges: triangle sides, a side shared by several triangles only once **/
+    mesh.edges.reserve(3 * triangleTotal + 2);
+    IndexTable edgeTable(3 * triangleTotal / 2 + 1);
+    for (size_t t = 0; t < triangleTotal; t++) {
+        const unsigned int* tri = &mesh.triangles[3 * t];
+        for (int i = 0; i < 3; i++) {
+            unsigned int a = tri[i];
+            unsigned int b = tri[(i + 1) % 3];
+            if (a == b)
+                continue; // Degenerate triangle
+            bool inserted;
+            uint64_t key = ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+            edgeTable.insert(key, (unsigned int)(mesh.edges.size() / 2), inserted);
+            if (inserted) {
+                mesh.edges.push_back(a);
+                mesh.edges.push_back(b);
+            }
+        }
+    }
+    return true;
+}
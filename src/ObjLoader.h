@@ -0,0 +1,32 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <vector>
+#include <string>
+#include "Vectors.h"
+
+// Triangle mesh welded from a Wavefront OBJ: one node per distinct
+// (position, texcoord) corner, numbered in order of first use by the faces.
+struct ObjMesh {
+    std::vector<Vec3> position;
+    std::vector<Vec2> texCoord;
+    std::vector<unsigned int> triangles; // 3 nodes per triangle
+    std::vector<unsigned int> edges;     // 2 nodes per edge, shared edges only once
+
+    size_t nodeCount() const { return position.size(); }
+    size_t triangleCount() const { return triangles.size() / 3; }
+    size_t edgeCount() const { return edges.size() / 2; }
+};
+
+// Reads v, vt and triangular f records ("f v", "f v/vt", "f v/vt/vn",
+// "f v//vn", negative indices relative). Everything else, and faces
+// with more than 3 corners, is skipped. The file is mapped, not copied:
+// the buffer is split at line starts and the chunks are parsed in
+// parallel, first counting records, then writing them at their offsets.
+class ObjLoader {
+public:
+    static bool load(const std::string& path, ObjMesh& mesh, std::string& error);
+    static bool parse(const char* data, size_t size, ObjMesh& mesh, std::string& error);
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "ParticleData.h"
+#include "Vectors.h"
+
+void ParticleData::reserve(size_t n)
+{
+	position.reserve(n);
+	old_position.reserve(n);
+	velocity.reserve(n);
+	force.reserve(n);
+	mass.reserve(n);
+	invMass.reserve(n);
+	isFixed.reserve(n);
+	initial_position.reserve(n);
+	normal.reserve(n);
+	tangent.reserve(n);
+	texCoord.reserve(n);
+}
+
+void ParticleData::resize(size_t n)
+{
+	position.resize(n);
+	old_position.resize(n);
+	velocity.resize(n);
+	force.resize(n);
+	mass.resize(n);
+	invMass.resize(n);
+	isFixed.resize(n);
+	initial_position.resize(n);
+	normal.resize(n);
+	tangent.resize(n);
+	texCoord.resize(n);
+}
+
+void ParticleData::clear()
+{
+	position.clear();
+	old_position.clear();
+	velocity.clear();
+	force.clear();
+	mass.clear();
+	invMass.clear();
+	isFixed.clear();
+	initial_position.clear();
+	normal.clear();
+	tangent.clear();
+	texCoord.clear();
+}
+
+unsigned int ParticleData::add(Vec3 p, Vec2 uv)
+{
+	position.push_back(p);
+	old_position.push_back(p);
+	velocity.push_back(Vec3());
+	force.push_back(Vec3());
+	mass.push_back(1.0);
+	invMass.push_back(1.0);
+	isFixed.push_back(0);
+	initial_position.push_back(p);
+	normal.push_back(Vec3());
+	tangent.push_back(Vec3());
+	texCoord.push_back(uv);
+
+	return (unsigned int)(position.size() - 1);
+}
+
+void ParticleData::set(unsigned int i, Vec3 p, Vec2 uv)
+{
+	position[i] = p;
+	old_position[i] = p;
+	velocity[i] = Vec3();
+	force[i] = Vec3();
+	mass[i] = 1.0;
+	invMass[i] = 1.0;
+	isFixed[i] = 0;
+	initial_position[i] = p;
+	normal[i] = Vec3();
+	tangent[i] = Vec3();
+	texCoord[i] = uv;
+}
+
+template <typename T>
+static void permuteStream(AlignedVector<T>& stream, const std::vector<unsigned int>& order)
+{
+	AlignedVector<T> permuted(stream.size());
+	for (size_t i = 0; i < stream.size(); i++)
+		permuted[i] = stream[order[i]];
+	stream.swap(permuted);
+}
+
+void ParticleData::permute(const std::vector<unsigned int>& order)
+{
+	permuteStream(position, order);
+	permuteStream(old_position, order);
+	permuteStream(velocity, order);
+	permuteStream(force, order);
+	permuteStream(mass, order);
+	permuteStream(invMass, order);
+	permuteStream(isFixed, order);
+	permuteStream(initial_position, order);
+	permuteStream(normal, order);
+	permuteStream(tangent, order);
+	permuteStream(texCoord, order);
+}
@@ -0,0 +1,74 @@
+#ifndef PARTICLE_DATA_H
+#define PARTICLE_DATA_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include "Vectors.h"
+
+// Allocator handing out cache-line (64 byte) aligned blocks, so that every
+// particle stream starts on its own cache line.
+template <typename T, std::size_t Alignment = 64>
+struct AlignedAllocator {
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+    AlignedAllocator() noexcept {}
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        // Over-allocate and keep the raw pointer just before the aligned block
+        std::size_t bytes = n * sizeof(T) + Alignment + sizeof(void*);
+        void* raw = ::operator new(bytes);
+        std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);
+        std::uintptr_t aligned = (start + Alignment - 1) & ~(std::uintptr_t)(Alignment - 1);
+        reinterpret_cast<void**>(aligned)[-1] = raw;
+        return reinterpret_cast<T*>(aligned);
+    }
+
+    void deallocate(T* p, std::size_t) noexcept {
+        if (p) ::operator delete(reinterpret_cast<void**>(p)[-1]);
+    }
+};
+
+template <typename T, typename U, std::size_t A>
+bool operator==(const AlignedAllocator<T, A>&, const AlignedAllocator<U, A>&) { return true; }
+template <typename T, typename U, std::size_t A>
+bool operator!=(const AlignedAllocator<T, A>&, const AlignedAllocator<U, A>&) { return false; }
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// Structure-of-arrays particle store: particle i is the i-th entry of every stream.
+// Integrators only stream through the arrays they actually need.
+class ParticleData {
+public:
+    // Simulation streams
+    AlignedVector<Vec3>          position;
+    AlignedVector<Vec3>          old_position;
+    AlignedVector<Vec3>          velocity;
+    AlignedVector<Vec3>          force;
+    AlignedVector<double>        mass;
+    AlignedVector<double>        invMass;  // w in PBD, 0 for pinned particles
+    AlignedVector<unsigned char> isFixed;
+
+    // Rendering and restart streams
+    AlignedVector<Vec3>          initial_position;
+    AlignedVector<Vec3>          normal;
+    AlignedVector<Vec3>          tangent;
+    AlignedVector<Vec2>          texCoord;
+
+    size_t size() const { return position.size(); }
+    void reserve(size_t n);
+    void resize(size_t n); // Exact count up front, then set() in any order
+    void clear();
+    unsigned int add(Vec3 p, Vec2 uv);
+    void set(unsigned int i, Vec3 p, Vec2 uv); // Same state as add, in place
+    void permute(const std::vector<unsigned int>& order); // New particle i is old particle order[i]
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include <string>
 #include <iostream>
+#include <cmath>
 
 #include "PositionBasedIntegrator.h"
 #include "ClothData.h"
@@ -8,12 +9,23 @@
 PositionBasedIntegrator::PositionBasedIntegrator(ClothData* d, std::string m) : cloth(d), method(m) {
     stretchingCoef = 0.0001f;
     bendingCoef = 0.3f;
+    sorFactor = 1.5; // Over-relaxation of the averaged Jacobi correction, in (0, 2)
+    jacobi = (method == "JacobiPBD");
+    chebyshev = (method == "ChebyshevPBD");
+    solverIterations = 1;
     gravity = Vec3(0.0, -9.8, 0.0);
     iterationFreq = 25.0;
     double simulation_time_step = 1.0f / 60.0f;
     TIME_STEP = simulation_time_step / iterationFreq;
 
-    if (method == "PBD") {
+    if (chebyshev) {
+        // Fewer substeps, several accelerated iterations per substep
+        iterationFreq = 5.0;
+        solverIterations = 10;
+        TIME_STEP = simulation_time_step / iterationFreq;
+    }
+
+    if (method == "PBD" || method == "JacobiPBD" || method == "ChebyshevPBD") {
         removeAdditionalSpring();
     }
 
@@ -21,105 +33,226 @@ PositionBasedIntegrator::PositionBasedIntegrator(ClothData* d, std::string m) :
         initCoeff();
     }
 
-    for (int i = 0; i < cloth->nodes.size(); ++i) {
-        if (cloth->nodes[i]->isFixed) {
-            cloth->nodes[i]->mass = std::numeric_limits<double>::infinity();
-            cloth->nodes[i]->w = 0;
-
-            cloth->nodes[i]->mass = std::numeric_limits<double>::infinity();
-            cloth->nodes[i]->w = 0;
+    ParticleData& p = cloth->particles;
+    for (int i = 0; i < p.size(); ++i) {
+        if (p.isFixed[i]) {
+            p.mass[i] = std::numeric_limits<double>::infinity();
+            p.invMass[i] = 0;
         }
     }
 
     std::cout << "Method: " << std::endl;
     std::cout << "- " << method << std::endl;
+
+    SpringData& springs = cloth->springs;
+    if (stencil.build(*cloth)) {
+        // Constraints straight from the grid layout, red-black per direction
+        std::cout << "- grid stencil: " << stencil.getWidth() << " x " << stencil.getHeight() << std::endl;
+        if (jacobi)
+            std::cout << "- Jacobi, SOR factor: " << sorFactor << std::endl;
+    }
+    else if (jacobi) {
+        // Corrections go to per-spring records, gathered per node
+        springs.buildAdjacency(p.size());
+        std::cout << "- Jacobi, SOR factor: " << sorFactor << std::endl;
+    }
+    else {
+        // Springs of one color share no node and can be projected in parallel
+        springs.buildColoring(p.size());
+        std::cout << "- constraint colors: " << springs.colorCount() << " (springs per color:";
+        for (unsigned int c = 0; c < springs.colorCount(); c++) {
+            std::cout << " " << springs.colorOffset[c + 1] - springs.colorOffset[c];
+        }
+        std::cout << ")" << std::endl;
+    }
+
+    if (chebyshev) {
+        estimateSpectralRadius();
+        std::cout << "- Chebyshev, spectral radius: " << cheb.getSpectralRadius() << std::endl;
+    }
+}
+
+void PositionBasedIntegrator::estimateSpectralRadius() {
+    // Plain sweeps pulling a perturbed state back to rest; the update norms
+    // decay like rho^k. Positions are restored afterwards.
+    ParticleData& p = cloth->particles;
+    AlignedVector<Vec3> rest = p.position;
+
+    for (int i = 0; i < p.size(); i++) {
+        if (p.invMass[i] != 0.0)
+            p.position[i] += Vec3(sin(1.3 * i), cos(0.7 * i), sin(2.1 * i)) * 0.01;
+    }
+
+    std::vector<double> updateNorms;
+    AlignedVector<Vec3> last;
+    for (int k = 0; k < 30; k++) {
+        last = p.position;
+        solve(TIME_STEP);
+
+        double norm = 0.0;
+        for (int i = 0; i < p.size(); i++) {
+            Vec3 d = p.position[i] - last[i];
+            norm += Vec3::dot(d, d);
+        }
+        updateNorms.push_back(sqrt(norm));
+    }
+    cheb.setSpectralRadius(ChebyshevAccelerator::estimateSpectralRadius(updateNorms));
+
+    p.position = rest;
 }
 
 void PositionBasedIntegrator::initCoeff() {
     for (int s = 0; s < cloth->springs.size(); ++s) {
-        if (cloth->springs[s]->id == 0) {
-            cloth->springs[s]->hookCoef = stretchingCoef;
+        if (cloth->springs.type[s] == 0) {
+            cloth->springs.hookCoef[s] = stretchingCoef;
         }
-        else if (cloth->springs[s]->id == 1 || cloth->springs[s]->id == 2) {
-            cloth->springs[s]->hookCoef = bendingCoef;
+        else if (cloth->springs.type[s] == 1 || cloth->springs.type[s] == 2) {
+            cloth->springs.hookCoef[s] = bendingCoef;
         }
-        else if (cloth->springs[s]->id == 3) {
-            cloth->springs[s]->hookCoef = stretchingCoef;
+        else if (cloth->springs.type[s] == 3) {
+            cloth->springs.hookCoef[s] = stretchingCoef;
         }
     }
 }
 
 void PositionBasedIntegrator::unpin() {
-    for (int i = 0; i < cloth->nodes.size(); ++i) {
-        if (cloth->nodes[i]->isFixed) {
-            cloth->nodes[i]->isFixed = false;
-            cloth->nodes[i]->mass = 1.0f;
-            cloth->nodes[i]->w = 1.0f;
+    ParticleData& p = cloth->particles;
+    for (int i = 0; i < p.size(); ++i) {
+        if (p.isFixed[i]) {
+            p.isFixed[i] = 0;
+            p.mass[i] = 1.0f;
+            p.invMass[i] = 1.0f;
         }
     }
 }
 
 void PositionBasedIntegrator::removeAdditionalSpring() {
-    for (int i = 0; i < cloth->springs.size(); i++) {
-        if (cloth->springs[i]->id == 3) {
-            delete cloth->springs[i];
-            cloth->springs.erase(cloth->springs.begin() + i);
-            i--;
-        }
-    }
+    cloth->springs.removeType(3);
 }
 
 void PositionBasedIntegrator::predict(double timeStep, Vec3 gravity) {
+    ParticleData& p = cloth->particles;
+
 #pragma omp parallel for
-    for (int n = 0; n < cloth->nodes.size(); n++) {
-        if (cloth->nodes[n]->w == 0.f)
+    for (int n = 0; n < p.size(); n++) {
+        if (p.invMass[n] == 0.f)
             continue;
 
-        cloth->nodes[n]->velocity += gravity * timeStep;
-        cloth->nodes[n]->old_position = cloth->nodes[n]->position;
-        cloth->nodes[n]->position += cloth->nodes[n]->velocity * timeStep;
+        p.velocity[n] += gravity * timeStep;
+        p.old_position[n] = p.position[n];
+        p.position[n] += p.velocity[n] * timeStep;
     }
 }
 
 void PositionBasedIntegrator::solveConstraint(double timeStep) {
+    ParticleData& p = cloth->particles;
+
+    const SpringData& springs = cloth->springs;
+
+    // Gauss-Seidel over colors: inside a color no two springs share a node
+    for (unsigned int color = 0; color < springs.colorCount(); color++) {
+#pragma omp parallel for
+        for (int c = springs.colorOffset[color]; c < (int)springs.colorOffset[color + 1]; c++) {
+            unsigned int n1 = springs.node1[c];
+            unsigned int n2 = springs.node2[c];
+            float alpha = springs.hookCoef[c] / timeStep / timeStep;
+            if ((p.invMass[n1] + p.invMass[n2]) == 0.f)
+                continue;
+
+            Vec3 distance = p.position[n1] - p.position[n2];
+            double distance_lenght = distance.length();
+
+            if (distance_lenght == 0.0f)
+                continue;
+
+            distance.normalize();
+            double rest_length = springs.restLen[c];
+            double error = distance_lenght - rest_length;
+            double correction = -error / (p.invMass[n1] + p.invMass[n2] + alpha);
+            double first_correction = correction * p.invMass[n1];
+            double second_correction = -correction * p.invMass[n2];
+
+            p.position[n1] += distance * first_correction;
+            p.position[n2] += distance * second_correction;
+        }
+    }
+}
+
+void PositionBasedIntegrator::solveConstraintJacobi(double timeStep) {
+    ParticleData& p = cloth->particles;
+    SpringData& springs = cloth->springs;
+
+    // Every spring computes its correction from the same positions
 #pragma omp parallel for
-    for (int c = 0; c < cloth->springs.size(); c++) {
-        float alpha = cloth->springs[c]->hookCoef / timeStep / timeStep;
-        if ((cloth->springs[c]->node1->w + cloth->springs[c]->node2->w) == 0.f)
+    for (int c = 0; c < springs.size(); c++) {
+        unsigned int n1 = springs.node1[c];
+        unsigned int n2 = springs.node2[c];
+        double alpha = springs.hookCoef[c] / timeStep / timeStep;
+        springs.record[c].setZeroVec();
+        if ((p.invMass[n1] + p.invMass[n2]) == 0.f)
             continue;
 
-        Vec3 distance = cloth->springs[c]->node1->position - cloth->springs[c]->node2->position;
+        Vec3 distance = p.position[n1] - p.position[n2];
         double distance_lenght = distance.length();
 
         if (distance_lenght == 0.0f)
             continue;
 
         distance.normalize();
-        double rest_length = cloth->springs[c]->restLen;
-        double error = distance_lenght - rest_length;
-        double correction = -error / (cloth->springs[c]->node1->w + cloth->springs[c]->node2->w + alpha);
-        double first_correction = correction * cloth->springs[c]->node1->w;
-        double second_correction = -correction * cloth->springs[c]->node2->w;
+        double error = distance_lenght - springs.restLen[c];
+        double correction = -error / (p.invMass[n1] + p.invMass[n2] + alpha);
 
-        cloth->springs[c]->node1->position += distance * first_correction;
-        cloth->springs[c]->node2->position += distance * second_correction;
+        // n1 moves by record * w1, n2 by -record * w2
+        springs.record[c] = distance * correction;
+    }
+
+    // Every node applies the average of its corrections, over-relaxed
+#pragma omp parallel for
+    for (int n = 0; n < p.size(); n++) {
+        unsigned int count = springs.degree(n);
+        if (p.invMass[n] == 0.0f || count == 0)
+            continue;
+
+        p.position[n] += springs.gatherRecord(n) * (sorFactor * p.invMass[n] / count);
     }
 }
 
+void PositionBasedIntegrator::solve(double timeStep) {
+    if (stencil.active()) {
+        if (jacobi)
+            stencil.solveConstraintJacobi(cloth->particles, timeStep, sorFactor);
+        else
+            stencil.solveConstraint(cloth->particles, timeStep);
+    }
+    else if (jacobi)
+        solveConstraintJacobi(timeStep);
+    else
+        solveConstraint(timeStep);
+}
+
 void PositionBasedIntegrator::updateVelocities(double timeStep) {
+    ParticleData& p = cloth->particles;
+
 #pragma omp parallel for
-    for (int n = 0; n < cloth->nodes.size(); n++) {
-        if (cloth->nodes[n]->w == 0.0f)
+    for (int n = 0; n < p.size(); n++) {
+        if (p.invMass[n] == 0.0f)
             continue;
 
-        cloth->nodes[n]->velocity = (cloth->nodes[n]->position - cloth->nodes[n]->old_position) * (1.0f / timeStep);
+        p.velocity[n] = (p.position[n] - p.old_position[n]) * (1.0f / timeStep);
     }
 }
 
 void PositionBasedIntegrator::update() {
+    ParticleData& p = cloth->particles;
+
     for (int i = 0; i < iterationFreq; i++) {
         predict(TIME_STEP, gravity);
-        solveConstraint(TIME_STEP);
+        for (int k = 0; k < solverIterations; k++) {
+            solve(TIME_STEP);
+
+            if (chebyshev)
+                cheb.apply(k, &p.position[0].x, p.size() * 3);
+        }
         for (auto* collider : colliders) {
             if (collider)
                 collider->resolveCollision(cloth);
@@ -7,6 +7,8 @@
 #include "IClothSimulator.h"
 #include "Vectors.h"
 #include "ICollider.h"
+#include "ChebyshevAccelerator.h"
+#include "GridStencil.h"
 
 class PositionBasedIntegrator : public IClothSimulator {
 public:
@@ -25,12 +27,21 @@ private:
 	double TIME_STEP;
 	double stretchingCoef; // stretching compliance
 	double bendingCoef; // bending compliance
+	bool jacobi; // Jacobi with constraint averaging instead of colored Gauss-Seidel
+	double sorFactor;
+	int solverIterations; // Constraint sweeps per substep
+	bool chebyshev;
+	ChebyshevAccelerator cheb;
+	GridStencil stencil; // Constraint list replacement for grid cloth
 
 	void initCoeff();
 	void removeAdditionalSpring();
 
 	void predict(double timeStep, Vec3 gravity);
 	void solveConstraint(double timeStep);
+	void solveConstraintJacobi(double timeStep);
+	void solve(double timeStep);
+	void estimateSpectralRadius();
 	void updateVelocities(double timeStep);
 };
 
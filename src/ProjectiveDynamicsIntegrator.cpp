@@ -1,5 +1,7 @@
 #include <iostream>
 #include <iomanip>
+#include <cmath>
+#include <algorithm>
 
 #include "ProjectiveDynamicsIntegrator.h"
 #include "ClothData.h"
@@ -8,13 +10,15 @@
 
 using namespace std;
 
-ProjectiveDynamicsIntegrator::ProjectiveDynamicsIntegrator(ClothData* data)
+ProjectiveDynamicsIntegrator::ProjectiveDynamicsIntegrator(ClothData* data, std::string m)
     : cloth(data),
-    LHS(data->nodes.size() * 3, data->nodes.size() * 3),
-    M(data->nodes.size() * 3, data->nodes.size() * 3),
-    x_new(data->nodes.size() * 3),
-    b(data->nodes.size() * 3),
-    s_t(data->nodes.size() * 3)
+    method(m),
+    LHS(data->particles.size(), data->particles.size()),
+    M(data->particles.size(), data->particles.size()),
+    x_new(data->particles.size(), 3),
+    b(data->particles.size(), 3),
+    s_t(data->particles.size(), 3),
+    inertia(data->particles.size())
 {
     TIME_STEP = 0.01;
     stretchingCoef = 10000.0f;
@@ -23,28 +27,259 @@ ProjectiveDynamicsIntegrator::ProjectiveDynamicsIntegrator(ClothData* data)
     gravity = Vec3(0.0, -9.8, 0.0);
 
     maxIterations =1;
-
-    collision_stiffness = 10000.0f;
+    solverIterations = 1;
+    chebyshev = (method == "ChebyshevPD");
+    anderson = (method == "AndersonPD");
+
+    collision_stiffness = 100000.0f;
+    pin_stiffness = 1.0e9;
+    maxCorrectionRank = 32;
+
+    // Pins are held by the constraints, not by their mass: restart() gives
+    // them PBD's infinite one, which would turn s_t and LHS into inf
+    ParticleData& p = cloth->particles;
+    mass.resize(p.size());
+    for (int i = 0; i < p.size(); i++) {
+        mass[i] = std::isfinite(p.mass[i]) ? p.mass[i] : 1.0;
+    }
    
     initCoeff();
-    initVars();
     removeZeroCoeffSpring();
+    initVars();
+    cloth->springs.buildAdjacency(data->particles.size());
+
+    std::cout << "Method: " << std::endl;
+    std::cout << "- " << method << std::endl;
+
+    if (chebyshev) {
+        solverIterations = 10;
+        estimateSpectralRadius();
+        std::cout << "- Chebyshev, spectral radius: " << cheb.getSpectralRadius() << std::endl;
+    }
+
+    if (anderson) {
+        solverIterations = 10;
+        std::cout << "- Anderson, window: " << aa.window << std::endl;
+    }
+}
+
+void ProjectiveDynamicsIntegrator::estimateSpectralRadius() {
+    // Plain local/global iterations pulling a perturbed state back to rest;
+    // the update norms decay like rho^k
+    ParticleData& p = cloth->particles;
+
+    for (int i = 0; i < p.size(); i++) {
+        Vec3 offset = Vec3(sin(1.3 * i), cos(0.7 * i), sin(2.1 * i)) * 0.01;
+        x_new(i, 0) = p.position[i].x + offset.x;
+        x_new(i, 1) = p.position[i].y + offset.y;
+        x_new(i, 2) = p.position[i].z + offset.z;
+
+        s_t(i, 0) = p.position[i].x * mass[i] / (TIME_STEP * TIME_STEP);
+        s_t(i, 1) = p.position[i].y * mass[i] / (TIME_STEP * TIME_STEP);
+        s_t(i, 2) = p.position[i].z * mass[i] / (TIME_STEP * TIME_STEP);
+    }
+
+    std::vector<double> updateNorms;
+    for (int k = 0; k < 30; k++) {
+        Eigen::MatrixX3d last = x_new;
+        iterate();
+        updateNorms.push_back((x_new - last).norm());
+    }
+    cheb.setSpectralRadius(ChebyshevAccelerator::estimateSpectralRadius(updateNorms));
 }
 
 void ProjectiveDynamicsIntegrator::initVars() {
 
-    for (int i = 0; i < cloth->nodes.size(); ++i) {
-        cloth->nodes[i]->residual_G = Vec3(0.0, 0.0, 0.0);
+    buildSystemMatrix(cloth, TIME_STEP, M, LHS);
+	
+    solver.analyzePattern(LHS);
+
+    // Value offsets of every spring entry, so stiffness edits rewrite LHS in place
+    auto slot = [&](int row, int col) {
+        const int* rows = LHS.innerIndexPtr();
+        const int* begin = rows + LHS.outerIndexPtr()[col];
+        const int* end = rows + LHS.outerIndexPtr()[col + 1];
+        return (int)(std::lower_bound(begin, end, row) - rows);
+    };
+    const SpringData& springs = cloth->springs;
+    springSlots.resize(springs.size() * 4);
+    for (int k = 0; k < springs.size(); ++k) {
+        int n1 = springs.node1[k];
+        int n2 = springs.node2[k];
+        springSlots[k * 4 + 0] = slot(n1, n1);
+        springSlots[k * 4 + 1] = slot(n1, n2);
+        springSlots[k * 4 + 2] = slot(n2, n1);
+        springSlots[k * 4 + 3] = slot(n2, n2);
+    }
+    diagSlots.resize(cloth->particles.size());
+    for (int i = 0; i < cloth->particles.size(); ++i) {
+        diagSlots[i] = slot(i, i);
+    }
+
+    // The initial pins go straight into the factorization
+    constraintKind.assign(cloth->particles.size(), 0);
+    factoredWeight.assign(cloth->particles.size(), 0.0);
+    updatePins();
+    refactor();
+    constraints.setSolver(&solver, cloth->particles.size(), maxCorrectionRank);
+}
+
+void ProjectiveDynamicsIntegrator::updateSystemMatrix() {
+    // Same sums as buildSystemMatrix, written into the existing nonzeros
+    const ParticleData& p = cloth->particles;
+    const SpringData& springs = cloth->springs;
+    double* values = LHS.valuePtr();
+
+    for (int k = 0; k < LHS.nonZeros(); ++k) {
+        values[k] = 0.0;
+    }
+    for (int k = 0; k < springs.size(); ++k) {
+        double w = springs.hookCoef[k];
+        values[springSlots[k * 4 + 0]] += w;
+        values[springSlots[k * 4 + 1]] += -w;
+        values[springSlots[k * 4 + 2]] += -w;
+        values[springSlots[k * 4 + 3]] += w;
+    }
+    for (int i = 0; i < p.size(); ++i) {
+        values[diagSlots[i]] += mass[i] / TIME_STEP / TIME_STEP + factoredWeight[i];
+    }
+}
+
+double ProjectiveDynamicsIntegrator::constraintWeight(int i) const {
+    return constraintKind[i] == 1 ? pin_stiffness : constraintKind[i] == 2 ? collision_stiffness : 0.0;
+}
+
+void ProjectiveDynamicsIntegrator::refactor() {
+    // Numeric refactorization with the current pins and contacts folded into
+    // the diagonal, reusing the symbolic analysis; nothing left to correct
+    for (int i = 0; i < cloth->particles.size(); ++i) {
+        factoredWeight[i] = constraintWeight(i);
+    }
+    updateSystemMatrix();
+    solver.factorize(LHS);
+    constraints.clear();
+    relaxed.clear();
+    stepsSinceRefactor = 0;
+}
+
+void ProjectiveDynamicsIntegrator::updateCorrection() {
+    // Whatever differs from the factored diagonal (pins and contacts changed
+    // since the last refactor) goes through the low-rank correction, as long
+    // as it stays small and its new columns cost less than refactoring.
+    // Past that the diagonal is refactored, but at most once per refactor
+    // cost worth of steps; in between the rest is relaxed per node.
+    int n = (int)cloth->particles.size();
+    int changed = 0;
+    int newColumns = 0;
+#pragma omp parallel for reduction(+:changed, newColumns)
+    for (int i = 0; i < n; ++i) {
+        if (constraintWeight(i) != factoredWeight[i]) {
+            changed++;
+            if (!constraints.contains(i))
+                newColumns++;
+        }
+    }
+
+    // A step costs 3 solves per iteration; new columns may double that
+    int stepColumns = 3 * solverIterations;
+    double refactorSteps = constraints.refactorCost() / stepColumns;
+    stepsSinceRefactor++;
+    if ((changed > constraints.capacity() || newColumns > constraints.refactorCost()) && stepsSinceRefactor >= refactorSteps) {
+        refactor();
+        return;
+    }
+
+    // Released columns first, so that new ones find room
+    for (int i = 0; i < n; ++i) {
+        if (constraints.contains(i) && constraintWeight(i) == factoredWeight[i])
+            constraints.set(i, 0.0);
+    }
+    relaxed.clear();
+    int columnBudget = stepColumns;
+    for (int i = 0; i < n; ++i) {
+        double delta = constraintWeight(i) - factoredWeight[i];
+        if (delta == 0.0)
+            continue;
+        if (constraints.contains(i))
+            constraints.set(i, delta);
+        else if (columnBudget > 0 && constraints.set(i, delta))
+            columnBudget--;
+        else
+            relaxed.push_back(i);
+    }
+}
+
+void ProjectiveDynamicsIntegrator::updatePins() {
+    // Follow pin changes (unpin, restart). They stay a low-rank correction
+    // until the next refactor folds them in.
+    ParticleData& p = cloth->particles;
+    for (int i = 0; i < p.size(); ++i) {
+        if (p.isFixed[i])
+            constraintKind[i] = 1;
+        else if (constraintKind[i] == 1)
+            constraintKind[i] = 0;
     }
+}
+
+void ProjectiveDynamicsIntegrator::updateContacts() {
+    // Contacts at the predicted positions, each a diagonal penalty on its
+    // node. Nodes that stay in contact keep their weight, only new and
+    // released contacts change the diagonal.
+    newContacts.clear();
+    for (auto collider : colliders) {
+        if (collider) {
+            collider->collectContacts(cloth, inertia, newContacts);
+        }
+    }
+
+    for (const Contact& c : contacts) {
+        if (constraintKind[c.node] == 2)
+            constraintKind[c.node] = 0;
+    }
+    size_t count = 0;
+    for (const Contact& c : newContacts) {
+        unsigned char& kind = constraintKind[c.node];
+        if (kind != 0)
+            continue; // Pinned, or already taken by another collider
+        kind = 2;
+        newContacts[count++] = c;
+    }
+    newContacts.resize(count);
+    contacts.swap(newContacts);
+
+    updateCorrection();
+}
+
+void ProjectiveDynamicsIntegrator::setStiffness(double stretching, double shear, double bending) {
+    stretchingCoef = stretching;
+    shearCoef = shear;
+    bendingCoef = bending;
+    initCoeff();
+
+    // Same sparsity pattern: numeric refactorization only, reusing the
+    // symbolic analysis, with the pins and contacts folded in
+    refactor();
+
+    if (chebyshev)
+        estimateSpectralRadius();
+}
+
+// LHS = M / h^2 + sum w A^T A, the constant PD system matrix. Shared with the
+// L-BFGS integrator, which uses it as its initial Hessian.
+void ProjectiveDynamicsIntegrator::buildSystemMatrix(const ClothData* cloth, double timeStep, Eigen::SparseMatrix<double>& M, Eigen::SparseMatrix<double>& LHS) {
+
+    const ParticleData& p = cloth->particles;
+
+    // x, y and z decouple: LHS is the same n x n matrix for every coordinate,
+    // so it is factored once and solved for the three columns of b
+    M.resize(p.size(), p.size());
+    LHS.resize(p.size(), p.size());
 
     // Initialize mass matrix M
     std::vector<Eigen::Triplet<double>> triplets;
     
-    for (int i = 0; i < cloth->nodes.size(); ++i) {
-        for (int j = 0; j < 3; ++j) {
-            int idx = i * 3 + j;
-            triplets.push_back(Eigen::Triplet<double>(idx, idx, cloth->nodes[i]->mass));
-        }
+    for (int i = 0; i < p.size(); ++i) {
+        triplets.push_back(Eigen::Triplet<double>(i, i, p.mass[i]));
     }
 
     M.setFromTriplets(triplets.begin(), triplets.end());
@@ -53,24 +288,16 @@ void ProjectiveDynamicsIntegrator::initVars() {
     triplets.clear();
     
     for (int k = 0; k < cloth->springs.size(); ++k) {
-        for (int i = 0; i < 3; ++i) {
-            
-                triplets.push_back(Eigen::Triplet<double>(cloth->springs[k]->node1->id*3 + i, cloth->springs[k]->node1->id * 3 + i, cloth->springs[k]->hookCoef));
+        triplets.push_back(Eigen::Triplet<double>(cloth->springs.node1[k], cloth->springs.node1[k], cloth->springs.hookCoef[k]));
 
-                triplets.push_back(Eigen::Triplet<double>(cloth->springs[k]->node1->id * 3 + i, cloth->springs[k]->node2->id * 3 + i, -cloth->springs[k]->hookCoef));
-                triplets.push_back(Eigen::Triplet<double>(cloth->springs[k]->node2->id * 3 + i, cloth->springs[k]->node1->id * 3 + i, -cloth->springs[k]->hookCoef));
+        triplets.push_back(Eigen::Triplet<double>(cloth->springs.node1[k], cloth->springs.node2[k], -cloth->springs.hookCoef[k]));
+        triplets.push_back(Eigen::Triplet<double>(cloth->springs.node2[k], cloth->springs.node1[k], -cloth->springs.hookCoef[k]));
 
-                triplets.push_back(Eigen::Triplet<double>(cloth->springs[k]->node2->id * 3 + i, cloth->springs[k]->node2->id * 3 + i, cloth->springs[k]->hookCoef));
-            
-        }
+        triplets.push_back(Eigen::Triplet<double>(cloth->springs.node2[k], cloth->springs.node2[k], cloth->springs.hookCoef[k]));
     }      
 
     LHS.setFromTriplets(triplets.begin(), triplets.end());
-	LHS += M / TIME_STEP / TIME_STEP;
-	
-    solver.analyzePattern(LHS);
-	solver.compute(LHS);
-
+	LHS += M / timeStep / timeStep;
 }
 
 void ProjectiveDynamicsIntegrator::initCoeff() {
@@ -84,16 +311,16 @@ void ProjectiveDynamicsIntegrator::initCoeff() {
     //3: quad springs
 
     for (int s = 0; s < cloth->springs.size(); ++s) {
-        if (cloth->springs[s]->id == 0) {
-            cloth->springs[s]->hookCoef = stretchingCoef;
+        if (cloth->springs.type[s] == 0) {
+            cloth->springs.hookCoef[s] = stretchingCoef;
             stretchCount++;
         }
-        else if (cloth->springs[s]->id == 1 || cloth->springs[s]->id == 2) {
-            cloth->springs[s]->hookCoef = shearCoef;
+        else if (cloth->springs.type[s] == 1 || cloth->springs.type[s] == 2) {
+            cloth->springs.hookCoef[s] = shearCoef;
             shearCount++;
         }
-        else if (cloth->springs[s]->id == 3) {
-            cloth->springs[s]->hookCoef = bendingCoef;
+        else if (cloth->springs.type[s] == 3) {
+            cloth->springs.hookCoef[s] = bendingCoef;
             bendingCount++;
         }
         else {
@@ -103,27 +330,17 @@ void ProjectiveDynamicsIntegrator::initCoeff() {
 }
 
 void ProjectiveDynamicsIntegrator::removeZeroCoeffSpring() {
-    int removedCount = 0;
-
-
     // Remove springs with zero coefficient
-    for (int i = 0; i < cloth->springs.size(); i++) {
-        if (cloth->springs[i]->hookCoef == 0.0) {
-            delete cloth->springs[i];
-            cloth->springs.erase(cloth->springs.begin() + i);
-            i--;
-            removedCount++;
-        }
-    }
-
+    cloth->springs.removeZeroCoeff();
 }
 
 void ProjectiveDynamicsIntegrator::unpin() {
     int unpinnedCount = 0;
 
-    for (int i = 0; i < cloth->nodes.size(); ++i) {
-        if (cloth->nodes[i]->isFixed) {
-            cloth->nodes[i]->isFixed = false;
+    ParticleData& p = cloth->particles;
+    for (int i = 0; i < p.size(); ++i) {
+        if (p.isFixed[i]) {
+            p.isFixed[i] = 0;
             unpinnedCount++;
         }
     }
@@ -132,10 +349,14 @@ void ProjectiveDynamicsIntegrator::unpin() {
 
 void ProjectiveDynamicsIntegrator::update() {
     // Iteration loop
+    ParticleData& p = cloth->particles;
+
+    updatePins();
+
     for (int iter = 0; iter < maxIterations; iter++) {
 
-        for (int i = 0; i < cloth->nodes.size(); i++) {
-            cloth->nodes[i]->old_position = cloth->nodes[i]->position;
+        for (int i = 0; i < p.size(); i++) {
+            p.old_position[i] = p.position[i];
         }
 
         // Compute forces
@@ -151,20 +372,20 @@ void ProjectiveDynamicsIntegrator::update() {
 
 void ProjectiveDynamicsIntegrator::computeInertia(double timeStep)
 {
-    // Reset forces
-    for (int i = 0; i < cloth->nodes.size(); i++) {
-        cloth->nodes[i]->inertia=Vec3(0.0, 0.0, 0.0);
-    }
+    ParticleData& p = cloth->particles;
+
     /** Nodes **/
+    // Pins stay where they are, whatever invMass they were given
 #pragma omp parallel for
-    for (int i = 0; i < cloth->nodes.size(); i++)
+    for (int i = 0; i < p.size(); i++)
     {
-
-        cloth->nodes[i]->inertia= cloth->nodes[i]->position
-                                + cloth->nodes[i]->velocity * timeStep
-			                    + cloth->nodes[i]->force * cloth->nodes[i]->w * timeStep * timeStep;
-
-                
+        if (p.isFixed[i]) {
+            inertia[i] = p.position[i];
+            continue;
+        }
+        inertia[i] = p.position[i]
+                   + p.velocity[i] * timeStep
+                   + p.force[i] * (timeStep * timeStep / mass[i]);
     }
 }
 std::vector<ICollider*> ProjectiveDynamicsIntegrator::getColliders() {
@@ -177,131 +398,198 @@ void ProjectiveDynamicsIntegrator::addCollider(ICollider* col) {
 
 void ProjectiveDynamicsIntegrator::computeForce(double timeStep, Vec3 gravity)
 {
+    ParticleData& p = cloth->particles;
+
     // Reset forces
-    for (int i = 0; i < cloth->nodes.size(); i++) {
-        cloth->nodes[i]->force = Vec3(0.0, 0.0, 0.0);
+    for (int i = 0; i < p.size(); i++) {
+        p.force[i] = Vec3(0.0, 0.0, 0.0);
     }
 
     /** Nodes **/
 #pragma omp parallel for
-    for (int i = 0; i < cloth->nodes.size(); i++)
+    for (int i = 0; i < p.size(); i++)
     {
-        cloth->nodes[i]->addForce(gravity * cloth->nodes[i]->mass);
+        p.force[i] += gravity * mass[i];
     }
 
 }
 
-void ProjectiveDynamicsIntegrator::integrate(double timeStep)
+void ProjectiveDynamicsIntegrator::iterate()
 {
+    ParticleData& p = cloth->particles;
+    SpringData& springs = cloth->springs;
 
-
-    /** Nodes **/
+    /** Local step **/
+    // Project every spring independently into its own record
 #pragma omp parallel for
-    for (int i = 0; i < cloth->nodes.size(); i++)
-    {
-        x_new(i * 3 + 0) = cloth->nodes[i]->inertia.x;
-        x_new(i * 3 + 1) = cloth->nodes[i]->inertia.y;
-        x_new(i * 3 + 2) = cloth->nodes[i]->inertia.z;
+    for (int j = 0; j < springs.size(); j++) {
+        int n1 = springs.node1[j];
+        int n2 = springs.node2[j];
 
-        s_t(i * 3 + 0) = cloth->nodes[i]->inertia.x * cloth->nodes[i]->mass / (timeStep * timeStep);
-        s_t(i * 3 + 1) = cloth->nodes[i]->inertia.y * cloth->nodes[i]->mass / (timeStep * timeStep);
-        s_t(i * 3 + 2) = cloth->nodes[i]->inertia.z * cloth->nodes[i]->mass / (timeStep * timeStep);
+        Vec3 p1 = Vec3(x_new(n1, 0), x_new(n1, 1), x_new(n1, 2));
+        Vec3 p2 = Vec3(x_new(n2, 0), x_new(n2, 1), x_new(n2, 2));
 
-    }
-    
-    for (int i = 0; i < maxIterations; i++) {
-        b = s_t;
-	
-        for (int j = 0; j < cloth->springs.size(); j++) {
-            int idx1 = cloth->springs[j]->node1->id * 3;
-			int idx2 = cloth->springs[j]->node2->id * 3;
+        Vec3 diffPos = p1 - p2;
+        double currLen = diffPos.length();
+        Vec3 unit_vec = diffPos / currLen;
 
+        double stretch = currLen - springs.restLen[j];
 
-            Vec3 p1 = Vec3(x_new(idx1 + 0), x_new(idx1 + 1), x_new(idx1 + 2));
-            Vec3 p2 = Vec3(x_new(idx2 + 0), x_new(idx2 + 1), x_new(idx2 + 2));
-			
-            Vec3 diffPos = p1 - p2;
-            double currLen = diffPos.length();
-            Vec3 unit_vec = diffPos / currLen;
+        Vec3 correction = unit_vec * (stretch / 2.0);
 
-            double stretch = currLen - cloth->springs[j]->restLen;
+        Vec3 p_c1 = p1 - correction;
+        Vec3 p_c2 = p2 + correction;
 
-            Vec3 correction = unit_vec * (stretch / 2.0);
+        // w * S^T * p, node2 gets the opposite
+        springs.record[j] = (p_c1 - p_c2) * springs.hookCoef[j];
+    }
 
-            Vec3 p_c1 = p1 - correction;
-            Vec3 p_c2 = p2 + correction;
-       
-            b[idx1 + 0] += cloth->springs[j]->hookCoef * (p_c1.x - p_c2.x);
-            b[idx1 + 1] += cloth->springs[j]->hookCoef * (p_c1.y - p_c2.y);
-            b[idx1 + 2] += cloth->springs[j]->hookCoef * (p_c1.z - p_c2.z);
+    /** Right hand side **/
+    // b = s_t + sum of incident projections, one writer per node; a pin
+    // pulls its node to where it is
+#pragma omp parallel for
+    for (int i = 0; i < p.size(); i++) {
+        Vec3 bi = springs.gatherRecord(i, Vec3(s_t(i, 0), s_t(i, 1), s_t(i, 2)));
+        if (constraintKind[i] == 1)
+            bi += p.position[i] * pin_stiffness;
+
+        b(i, 0) = bi.x;
+        b(i, 1) = bi.y;
+        b(i, 2) = bi.z;
+    }
 
+    // Contacts: project onto the outer side of the contact plane, the
+    // projection is the target of the node's diagonal penalty
+    for (const Contact& c : contacts) {
+        Vec3 x = Vec3(x_new(c.node, 0), x_new(c.node, 1), x_new(c.node, 2));
+        double depth = Vec3::dot(x - c.point, c.normal);
+        Vec3 target = depth < 0.0 ? x - Vec3(c.normal) * depth : x;
+        b(c.node, 0) += target.x * collision_stiffness;
+        b(c.node, 1) += target.y * collision_stiffness;
+        b(c.node, 2) += target.z * collision_stiffness;
+    }
 
-            b[idx2 + 0] += cloth->springs[j]->hookCoef * (p_c2.x - p_c1.x);
-            b[idx2 + 1] += cloth->springs[j]->hookCoef * (p_c2.y - p_c1.y);
-            b[idx2 + 2] += cloth->springs[j]->hookCoef * (p_c2.z - p_c1.z);
+    // One factorization, three right hand sides, whatever changed on the
+    // diagonal since as a low-rank correction. Changes the correction had
+    // no room for are lagged: the solve sees them at the current iterate,
+    // then their rows are solved with the neighbours fixed (Jacobi)
+    Eigen::MatrixX3d lagged(relaxed.size(), 3);
+    for (size_t k = 0; k < relaxed.size(); k++) {
+        unsigned int i = relaxed[k];
+        lagged.row(k) = (constraintWeight(i) - factoredWeight[i]) * x_new.row(i);
+        b.row(i) -= lagged.row(k);
+    }
 
+    x_new = solver.solve(b);
+    constraints.apply(x_new);
+
+    for (size_t k = 0; k < relaxed.size(); k++) {
+        unsigned int i = relaxed[k];
+        Eigen::RowVector3d r = b.row(i) + lagged.row(k);
+        double diag = 0.0;
+        for (Eigen::SparseMatrix<double>::InnerIterator it(LHS, i); it; ++it) {
+            if (it.row() == (int)i)
+                diag = it.value();
+            else
+                r -= it.value() * x_new.row(it.row());
         }
+        x_new.row(i) = r / (diag + constraintWeight(i) - factoredWeight[i]);
+    }
+}
 
-        for (auto collider : colliders) {
-            if (collider) {
-                collider->resolveCollision(cloth);
-            }
-		}
-        
-#pragma omp parallel for
-        for (int i = 0; i < cloth->nodes.size(); i++) {
-            
-            if (cloth->nodes[i]->position != cloth->nodes[i]->old_position) {
-                int idx = i * 3;
-                //toChange.push_back(idx);
-                b[idx + 0] += (cloth->nodes[i]->position.x - cloth->nodes[i]->old_position.x) * collision_stiffness;
-                b[idx + 1] += (cloth->nodes[i]->position.y - cloth->nodes[i]->old_position.y) * collision_stiffness;
-                b[idx + 2] += (cloth->nodes[i]->position.z - cloth->nodes[i]->old_position.z) * collision_stiffness;
-            }
-        }
+double ProjectiveDynamicsIntegrator::energy(const Eigen::MatrixX3d& x)
+{
+    // E(x) = 1/(2h^2) |x - inertia|_M^2 + sum w/2 (|x1 - x2| - rest)^2
+    ParticleData& p = cloth->particles;
+    SpringData& springs = cloth->springs;
+    double h2 = TIME_STEP * TIME_STEP;
+
+    double inertial = 0.0;
+#pragma omp parallel for reduction(+:inertial)
+    for (int i = 0; i < p.size(); i++) {
+        Vec3 d = Vec3(x(i, 0), x(i, 1), x(i, 2)) - inertia[i];
+        inertial += mass[i] * Vec3::dot(d, d);
+    }
 
-        /*
-        if (toChange.size() > 0) {
-//#pragma omp parallel for
-            for (int k = 0; k < toChange.size(); ++k) {
-                int idx = toChange[k];
-                LHS.coeffRef(idx + 0, idx + 0) += collision_stiffness;
-                LHS.coeffRef(idx + 1, idx + 1) += collision_stiffness;
-                LHS.coeffRef(idx + 2, idx + 2) += collision_stiffness;
-            }
-        
-            solver.analyzePattern(LHS);
-            solver.compute(LHS);
-        }
-        */
+    double elastic = 0.0;
+#pragma omp parallel for reduction(+:elastic)
+    for (int j = 0; j < springs.size(); j++) {
+        int n1 = springs.node1[j];
+        int n2 = springs.node2[j];
+        Vec3 d = Vec3(x(n1, 0) - x(n2, 0), x(n1, 1) - x(n2, 1), x(n1, 2) - x(n2, 2));
+        double stretch = d.length() - springs.restLen[j];
+        elastic += springs.hookCoef[j] * stretch * stretch;
+    }
+
+    for (const Contact& c : contacts) {
+        Vec3 d = Vec3(x(c.node, 0), x(c.node, 1), x(c.node, 2)) - c.point;
+        double depth = std::min(Vec3::dot(d, c.normal), 0.0);
+        elastic += collision_stiffness * depth * depth;
+    }
 
-        x_new = solver.solve(b);
+    return 0.5 * inertial / h2 + 0.5 * elastic;
+}
 
+void ProjectiveDynamicsIntegrator::andersonStep()
+{
+    // x_new holds the plain step G(x_prev), which never increases the energy.
+    // Keep the accelerated iterate only if it does not increase it either.
+    Eigen::MatrixX3d plain = x_new;
+    aa.compute(x_prev.data(), plain.data(), x_new.data(), x_new.size());
+
+    double e = energy(x_new);
+    if (e > lastEnergy) {
+        x_new = plain;
+        aa.reset();
+        e = energy(x_new);
     }
+    lastEnergy = e;
+}
 
+void ProjectiveDynamicsIntegrator::integrate(double timeStep)
+{
+    ParticleData& p = cloth->particles;
+
+    /** Nodes **/
 #pragma omp parallel for
-    for (int i = 0; i < cloth->nodes.size(); ++i) {
-        if (!cloth->nodes[i]->isFixed) {
-            cloth->nodes[i]->position = Vec3(x_new[i * 3 + 0], x_new[i * 3 + 1], x_new[i * 3 + 2]);
-            cloth->nodes[i]->velocity = (cloth->nodes[i]->position - cloth->nodes[i]->old_position) / TIME_STEP;
-        }
+    for (int i = 0; i < p.size(); i++)
+    {
+        x_new(i, 0) = inertia[i].x;
+        x_new(i, 1) = inertia[i].y;
+        x_new(i, 2) = inertia[i].z;
+
+        s_t(i, 0) = inertia[i].x * mass[i] / (timeStep * timeStep);
+        s_t(i, 1) = inertia[i].y * mass[i] / (timeStep * timeStep);
+        s_t(i, 2) = inertia[i].z * mass[i] / (timeStep * timeStep);
+
     }
-    /*
-    if (toChange.size() > 0) {
-//#pragma omp parallel for
-        for (int k = 0; k < toChange.size(); ++k) {
-            int idx = toChange[k];
-            LHS.coeffRef(idx + 0, idx + 0) -= collision_stiffness;
-            LHS.coeffRef(idx + 1, idx + 1) -= collision_stiffness;
-            LHS.coeffRef(idx + 2, idx + 2) -= collision_stiffness;
-        }
 
-        solver.analyzePattern(LHS);
-        solver.compute(LHS);
-        toChange.clear();
-        
+    updateContacts();
+    
+    if (anderson) {
+        aa.reset();
+        lastEnergy = energy(x_new);
+    }
+
+    for (int i = 0; i < solverIterations; i++) {
+        if (anderson)
+            x_prev = x_new;
+
+        iterate();
+
+        if (chebyshev)
+            cheb.apply(i, x_new.data(), x_new.size());
+        else if (anderson)
+            andersonStep();
+    }
+
+#pragma omp parallel for
+    for (int i = 0; i < p.size(); ++i) {
+        if (!p.isFixed[i]) {
+            p.position[i] = Vec3(x_new(i, 0), x_new(i, 1), x_new(i, 2));
+            p.velocity[i] = (p.position[i] - p.old_position[i]) / TIME_STEP;
+        }
     }
-    */
    
     
     /* attaching pbd collision resolver
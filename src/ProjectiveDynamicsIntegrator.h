@@ -1,18 +1,26 @@
 #ifndef PROJECIVE_DYNAMICS_INTEGRATOR_H
 #define PROJECIVE_DYNAMICS_INTEGRATOR_H
 
+#include <string>
 #include "ClothData.h"
 #include "IClothSimulator.h"
 #include "Vectors.h"
+#include "ChebyshevAccelerator.h"
+#include "AndersonAccelerator.h"
+#include "LowRankUpdate.h"
 #include <Eigen/Sparse>
+#include <Eigen/Dense>
 
 class ProjectiveDynamicsIntegrator : public IClothSimulator {
 public:
-	ProjectiveDynamicsIntegrator(ClothData* data);
+	ProjectiveDynamicsIntegrator(ClothData* data, std::string method = "ProjectiveDynamics");
 	void update() override;
 	void unpin() override;
 	std::vector<ICollider*> getColliders() override;
 	void addCollider(ICollider* col) override;
+	void setStiffness(double stretching, double shear, double bending) override;
+
+	static void buildSystemMatrix(const ClothData* cloth, double timeStep, Eigen::SparseMatrix<double>& M, Eigen::SparseMatrix<double>& LHS);
 
 private:
 	ClothData* cloth;
@@ -24,25 +32,54 @@ private:
 	double stretchingCoef;
 	double bendingCoef;
 	double shearCoef;
+	std::vector<double> mass; // Per node, finite for pins too
 
 	int maxIterations;
+	int solverIterations; // Local/global iterations per step
+	bool chebyshev;
+	ChebyshevAccelerator cheb;
+	bool anderson;
+	AndersonAccelerator aa;
+	double lastEnergy;
+	Eigen::MatrixX3d x_prev;
 
 	double collision_stiffness;
-	std::vector<int> toChange;
+	double pin_stiffness;
+	int maxCorrectionRank; // Diagonal changes kept out of LHS before refactoring
+	std::vector<unsigned char> constraintKind; // Per node: 0 free, 1 pinned, 2 contact
+	std::vector<double> factoredWeight; // Diagonal penalty per node inside LHS
+	LowRankUpdate constraints; // constraintWeight - factoredWeight on top of the cached factorization
+	std::vector<unsigned int> relaxed; // Changed nodes past the correction's capacity
+	int stepsSinceRefactor;
+	std::vector<Contact> contacts;
+	std::vector<Contact> newContacts;
 
 	Eigen::SparseMatrix<double> LHS;
 	Eigen::SparseMatrix<double> M;
 	Eigen::SimplicialLLT < Eigen::SparseMatrix<double >> solver;
+	std::vector<int> springSlots; // 4 offsets into LHS values per spring: (1,1) (1,2) (2,1) (2,2)
+	std::vector<int> diagSlots; // Offset of (i, i) in LHS values
 	
-	Eigen::VectorXd x_new;
-	Eigen::VectorXd b;
-	Eigen::VectorXd s_t;
+	Eigen::MatrixX3d x_new; // One column per coordinate
+	Eigen::MatrixX3d b;
+	Eigen::MatrixX3d s_t;
+	AlignedVector<Vec3> inertia;
 	
 	void initCoeff();
 	void initVars();
 	void removeZeroCoeffSpring();
+	double constraintWeight(int i) const;
+	void refactor();
+	void updateCorrection();
+	void updatePins();
+	void updateContacts();
+	void updateSystemMatrix();
 	void computeForce(double timeStep, Vec3 gravity);
 	void computeInertia(double timeStep);
+	void estimateSpectralRadius();
+	void iterate();
+	double energy(const Eigen::MatrixX3d& x);
+	void andersonStep();
 	void integrate(double timeStep);
 };
 
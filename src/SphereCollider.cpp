@@ -2,7 +2,6 @@
 #include "Sphere.h"
 #include "SphereCollider.h"
 #include "Vectors.h"
-#include "Display.h"
 
 
 SphereCollider::SphereCollider() {
@@ -13,12 +12,10 @@ SphereCollider::SphereCollider() {
 	radius = 2.0;
 	color = glm::vec4(0.1f, 0.9f, 0.1f, 1.0f);
 	sphere = new Sphere(center, radius, color);
-	renderer = new SphereRender(sphere);
 }
 
 SphereCollider::~SphereCollider() {
 	delete sphere;
-	delete renderer;
 }
 
 SphereCollider::SphereCollider(Vec3 center) : center(center){
@@ -26,23 +23,28 @@ SphereCollider::SphereCollider(Vec3 center) : center(center){
 	radius = 2;
 	color = glm::vec4(0.1f, 0.9f, 0.1f, 1.0f);
 	sphere = new Sphere(center, radius, color);
-	renderer = new SphereRender(sphere);
+}
+
+bool SphereCollider::closestSurface(Vec3 p, Vec3& surface, Vec3& normal) {
+	Vec3 distVec = p - center;
+	double distLen = distVec.length();
+	double safeDist = radius * 1.15;
+	if (distLen >= safeDist)
+		return false;
+
+	distVec.normalize();
+	surface = distVec * safeDist + center;
+	normal = distVec;
+	return true;
 }
 
 void SphereCollider::resolveCollision(ClothData* data) {
 #pragma omp parallel for
-	for (int i = 0; i < data->nodes.size(); ++i) {
-		Vec3 distVec = data->getWorldPos(data->nodes[i]) - center;
-		double distLen = distVec.length();
-		double safeDist = radius * 1.15;
-		if (distLen < safeDist) {
-			distVec.normalize();
-			data->setWorldPos(data->nodes[i], distVec * safeDist + center);
-			data->nodes[i]->velocity = data->nodes[i]->velocity * sphere->friction;
+	for (int i = 0; i < data->particles.size(); ++i) {
+		Vec3 surface, normal;
+		if (closestSurface(data->getWorldPos(i), surface, normal)) {
+			data->setWorldPos(i, surface);
+			data->particles.velocity[i] = data->particles.velocity[i] * sphere->friction;
 		}
 	}
 }
-
-void SphereCollider::render() {
-	renderer->flush();
-}
\ No newline at end of file
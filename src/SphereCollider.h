@@ -6,8 +6,6 @@
 #include "Vectors.h"
 #include "Sphere.h"
 
-class SphereRender;
-
 class SphereCollider : public ICollider {
 public:
     Vec3 center;
@@ -15,12 +13,11 @@ public:
     glm::vec4 color;
 
     Sphere* sphere;
-	SphereRender* renderer;
 
     SphereCollider();
     SphereCollider(Vec3 center);
     void resolveCollision(ClothData* data) override;
-    void render() override;
+    bool closestSurface(Vec3 p, Vec3& surface, Vec3& normal) override;
     ~SphereCollider();
 };
 
@@ -3,7 +3,8 @@
 #include "SweptSphereTriCollider.h"
 #include <vector>
 #include <string>
-#include "Display.h"
+#include <fstream>
+#include <sstream>
 
 SphereMeshesCollider::SphereMeshesCollider(const std::string& filepath) : path(filepath){
 	init(path, 10.0, Vec3(3.0f, 0.0f, -2.0));
@@ -161,6 +162,23 @@ void SphereMeshesCollider::resolveCollision(ClothData* data) {
     }
 };
 
+// The primitive pushing p the farthest, as resolveCollision ends up there
+bool SphereMeshesCollider::closestSurface(Vec3 p, Vec3& surface, Vec3& normal) {
+    double farthest = -1.0;
+    for (auto* prim : primitives) {
+        Vec3 s, n;
+        if (prim->closestSurface(p, s, n)) {
+            double push = (s - p).length();
+            if (push > farthest) {
+                farthest = push;
+                surface = s;
+                normal = n;
+            }
+        }
+    }
+    return farthest >= 0.0;
+}
+
 void SphereMeshesCollider::render() {
     for (auto* p : primitives) {
         p->render();
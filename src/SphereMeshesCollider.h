@@ -5,7 +5,6 @@
 #include <string>
 #include "ICollider.h"
 #include "Vectors.h"
-#include "Display.h"
 #include "SweptSphereCollider.h"
 
 class SphereMeshesCollider : public ICollider {
@@ -17,6 +16,7 @@ public:
     SphereMeshesCollider(const std::string& filepath);
     void init(const std::string& filepath, const double scale, const Vec3& translation);
     void resolveCollision(ClothData* data) override;
+    bool closestSurface(Vec3 p, Vec3& surface, Vec3& normal) override;
     void render() override;
     ~SphereMeshesCollider();
 };
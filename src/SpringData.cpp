@@ -0,0 +1,292 @@
+#include <algorithm>
+
+#include "SpringData.h"
+#include "ParticleData.h"
+#include "Vectors.h"
+
+SpringData::SpringData() : dampCoef(5.0) {}
+
+void SpringData::reserve(size_t n)
+{
+	node1.reserve(n);
+	node2.reserve(n);
+	restLen.reserve(n);
+	hookCoef.reserve(n);
+	type.reserve(n);
+}
+
+void SpringData::resize(size_t n)
+{
+	node1.resize(n);
+	node2.resize(n);
+	restLen.resize(n);
+	hookCoef.resize(n);
+	type.resize(n);
+}
+
+void SpringData::clear()
+{
+	node1.clear();
+	node2.clear();
+	restLen.clear();
+	hookCoef.clear();
+	type.clear();
+	record.clear();
+	adjOffset.clear();
+	adjSpring.clear();
+	colorOffset.clear();
+	nodeColorOffset.clear();
+	nodeColorOrder.clear();
+}
+
+unsigned int SpringData::add(unsigned char t, const ParticleData& particles, unsigned int n1, unsigned int n2, double k)
+{
+	node1.push_back(n1);
+	node2.push_back(n2);
+	restLen.push_back(Vec3::dist(particles.position[n1], particles.position[n2]));
+	hookCoef.push_back(k);
+	type.push_back(t);
+
+	return (unsigned int)(node1.size() - 1);
+}
+
+void SpringData::set(unsigned int s, unsigned char t, const ParticleData& particles, unsigned int n1, unsigned int n2, double k)
+{
+	node1[s] = n1;
+	node2[s] = n2;
+	restLen[s] = Vec3::dist(particles.position[n1], particles.position[n2]);
+	hookCoef[s] = k;
+	type[s] = t;
+}
+
+void SpringData::removeZeroCoeff()
+{
+	std::vector<char> keep(size());
+	for (size_t s = 0; s < size(); s++) {
+		keep[s] = hookCoef[s] != 0.0;
+	}
+	compact(keep);
+}
+
+void SpringData::removeType(unsigned char t)
+{
+	std::vector<char> keep(size());
+	for (size_t s = 0; s < size(); s++) {
+		keep[s] = type[s] != t;
+	}
+	compact(keep);
+}
+
+void SpringData::renumberNodes(const std::vector<unsigned int>& newIndex)
+{
+	for (size_t s = 0; s < size(); s++) {
+		node1[s] = newIndex[node1[s]];
+		node2[s] = newIndex[node2[s]];
+	}
+
+	// Springs follow their nodes: sorted by lower then upper endpoint, stable
+	std::vector<unsigned int> order(size());
+	for (size_t s = 0; s < size(); s++)
+		order[s] = (unsigned int)s;
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+		unsigned int loA = std::min(node1[a], node2[a]), loB = std::min(node1[b], node2[b]);
+		if (loA != loB) return loA < loB;
+		return std::max(node1[a], node2[a]) < std::max(node1[b], node2[b]);
+	});
+	permute(order);
+	colorOffset.clear();
+	nodeColorOffset.clear();
+	nodeColorOrder.clear();
+}
+
+void SpringData::compact(const std::vector<char>& keep) // Stable in-place removal, keeps spring order
+{
+	size_t n = 0;
+	for (size_t s = 0; s < size(); s++) {
+		if (!keep[s]) continue;
+		node1[n] = node1[s];
+		node2[n] = node2[s];
+		restLen[n] = restLen[s];
+		hookCoef[n] = hookCoef[s];
+		type[n] = type[s];
+		n++;
+	}
+	node1.resize(n);
+	node2.resize(n);
+	restLen.resize(n);
+	hookCoef.resize(n);
+	type.resize(n);
+
+	// Spring indices changed, the adjacency and coloring have to be rebuilt
+	record.clear();
+	adjOffset.clear();
+	adjSpring.clear();
+	colorOffset.clear();
+	nodeColorOffset.clear();
+	nodeColorOrder.clear();
+}
+
+void SpringData::permute(const std::vector<unsigned int>& order) // New spring s is old spring order[s]
+{
+	AlignedVector<unsigned int> n1(size()), n2(size());
+	AlignedVector<double> len(size()), k(size());
+	AlignedVector<unsigned char> t(size());
+	for (size_t s = 0; s < size(); s++) {
+		n1[s] = node1[order[s]];
+		n2[s] = node2[order[s]];
+		len[s] = restLen[order[s]];
+		k[s] = hookCoef[order[s]];
+		t[s] = type[order[s]];
+	}
+	node1.swap(n1);
+	node2.swap(n2);
+	restLen.swap(len);
+	hookCoef.swap(k);
+	type.swap(t);
+
+	record.clear();
+	adjOffset.clear();
+	adjSpring.clear();
+}
+
+void SpringData::applyInternalForce(unsigned int s, ParticleData& particles) const // Compute spring internal force
+{
+	unsigned int n1 = node1[s];
+	unsigned int n2 = node2[s];
+	Vec3 p1 = particles.position[n1];
+	Vec3 p2 = particles.position[n2];
+	double currLen = Vec3::dist(p1, p2);
+	Vec3 fDir1 = (p2 - p1) / currLen;
+	Vec3 diffV1 = particles.velocity[n2] - particles.velocity[n1];
+	Vec3 f1 = fDir1 * ((currLen - restLen[s]) * hookCoef[s] + Vec3::dot(diffV1, fDir1) * dampCoef);
+
+	particles.force[n1] += f1;
+	particles.force[n2] += f1.minus();
+}
+
+void SpringData::buildAdjacency(size_t nodeCount)
+{
+	record.assign(size(), Vec3());
+	adjOffset.assign(nodeCount + 1, 0);
+	adjSpring.resize(size() * 2);
+
+	// Count incident springs per node, then prefix sum
+	for (size_t s = 0; s < size(); s++) {
+		adjOffset[node1[s] + 1]++;
+		adjOffset[node2[s] + 1]++;
+	}
+	for (size_t n = 0; n < nodeCount; n++) {
+		adjOffset[n + 1] += adjOffset[n];
+	}
+
+	// Fill in ascending spring order, so the gather adds contributions in the
+	// same order as the serial loop and gives bit-identical forces
+	std::vector<unsigned int> cursor(adjOffset.begin(), adjOffset.end() - 1);
+	for (size_t s = 0; s < size(); s++) {
+		adjSpring[cursor[node1[s]]++] = (unsigned int)(s * 2);
+		adjSpring[cursor[node2[s]]++] = (unsigned int)(s * 2 + 1);
+	}
+}
+
+void SpringData::computeInternalForce(unsigned int s, const ParticleData& particles) // Same force as applyInternalForce, stored in the spring record
+{
+	Vec3 p1 = particles.position[node1[s]];
+	Vec3 p2 = particles.position[node2[s]];
+	double currLen = Vec3::dist(p1, p2);
+	Vec3 fDir1 = (p2 - p1) / currLen;
+	Vec3 diffV1 = Vec3(particles.velocity[node2[s]]) - particles.velocity[node1[s]];
+	record[s] = fDir1 * ((currLen - restLen[s]) * hookCoef[s] + Vec3::dot(diffV1, fDir1) * dampCoef);
+}
+
+void SpringData::gatherInternalForce(unsigned int n, ParticleData& particles) const
+{
+	particles.force[n] = gatherRecord(n, particles.force[n]);
+}
+
+void SpringData::buildColoring(size_t nodeCount)
+{
+	// Greedy edge coloring: each spring takes the smallest color not yet used
+	// by another spring on either of its endpoints
+	std::vector<std::vector<unsigned int>> nodeColors(nodeCount);
+	std::vector<unsigned int> color(size());
+	std::vector<char> used;
+	unsigned int colors = 0;
+	for (size_t s = 0; s < size(); s++) {
+		used.assign(colors + 1, 0);
+		for (unsigned int c : nodeColors[node1[s]]) used[c] = 1;
+		for (unsigned int c : nodeColors[node2[s]]) used[c] = 1;
+		unsigned int c = 0;
+		while (used[c]) c++;
+
+		color[s] = c;
+		nodeColors[node1[s]].push_back(c);
+		nodeColors[node2[s]].push_back(c);
+		if (c == colors) colors++;
+	}
+
+	// Counting sort by color, stable inside a color
+	std::vector<unsigned int> offset(colors + 1, 0);
+	for (size_t s = 0; s < size(); s++) {
+		offset[color[s] + 1]++;
+	}
+	for (unsigned int c = 0; c < colors; c++) {
+		offset[c + 1] += offset[c];
+	}
+	std::vector<unsigned int> order(size());
+	std::vector<unsigned int> cursor(offset.begin(), offset.end() - 1);
+	for (size_t s = 0; s < size(); s++) {
+		order[cursor[color[s]]++] = (unsigned int)s;
+	}
+
+	permute(order);
+	colorOffset = offset;
+}
+
+void SpringData::buildNodeColoring(size_t nodeCount)
+{
+	// Greedy node coloring over the adjacency (buildAdjacency first): each
+	// node takes the smallest color none of its spring neighbours has
+	std::vector<unsigned int> color(nodeCount);
+	std::vector<char> used;
+	unsigned int colors = 0;
+	for (size_t n = 0; n < nodeCount; n++) {
+		used.assign(colors + 1, 0);
+		for (unsigned int k = adjOffset[n]; k < adjOffset[n + 1]; k++) {
+			unsigned int s = adjSpring[k] >> 1;
+			unsigned int other = (adjSpring[k] & 1) ? node1[s] : node2[s];
+			if (other < n)
+				used[color[other]] = 1;
+		}
+		unsigned int c = 0;
+		while (used[c]) c++;
+
+		color[n] = c;
+		if (c == colors) colors++;
+	}
+
+	// Counting sort by color, ascending node index inside a color
+	nodeColorOffset.assign(colors + 1, 0);
+	for (size_t n = 0; n < nodeCount; n++) {
+		nodeColorOffset[color[n] + 1]++;
+	}
+	for (unsigned int c = 0; c < colors; c++) {
+		nodeColorOffset[c + 1] += nodeColorOffset[c];
+	}
+	nodeColorOrder.resize(nodeCount);
+	std::vector<unsigned int> cursor(nodeColorOffset.begin(), nodeColorOffset.end() - 1);
+	for (size_t n = 0; n < nodeCount; n++) {
+		nodeColorOrder[cursor[color[n]]++] = (unsigned int)n;
+	}
+}
+
+Vec3 SpringData::gatherRecord(unsigned int n, Vec3 sum) const // Adds the incident records to sum, in spring order
+{
+	for (unsigned int k = adjOffset[n]; k < adjOffset[n + 1]; k++) {
+		unsigned int s = adjSpring[k] >> 1;
+		if (adjSpring[k] & 1)
+			sum -= record[s];
+		else
+			sum += record[s];
+	}
+	return sum;
+}
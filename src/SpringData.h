@@ -0,0 +1,68 @@
+#ifndef SPRING_DATA_H
+#define SPRING_DATA_H
+
+#include <vector>
+#include "ParticleData.h"
+#include "Vectors.h"
+
+// Compact spring (distance constraint) buffer: spring s is the s-th entry of
+// every array. Endpoints are particle indices into ParticleData.
+class SpringData {
+public:
+    //0: quad springs
+    //1: first diagonal spring (\)
+    //2: second diagonal spring (/)
+    //3: quad springs (skip one node)
+    AlignedVector<unsigned int>  node1;
+    AlignedVector<unsigned int>  node2;
+    AlignedVector<double>        restLen;
+    AlignedVector<double>        hookCoef; // Compliance in PBD Approach
+    AlignedVector<unsigned char> type;
+    double dampCoef;
+
+    // Parallel assembly: every spring writes its own record, then every node
+    // gathers the records of its incident springs (CSR adjacency).
+    AlignedVector<Vec3>          record;     // Force (or PBD correction) on node1, node2 gets the opposite
+    AlignedVector<unsigned int>  adjOffset;  // Node n owns adjSpring[adjOffset[n] .. adjOffset[n + 1])
+    AlignedVector<unsigned int>  adjSpring;  // spring * 2 + endpoint (0: node1, 1: node2)
+
+    // Constraint graph coloring: springs of one color share no node, and are
+    // stored contiguously in springs [colorOffset[c], colorOffset[c + 1])
+    std::vector<unsigned int>    colorOffset;
+
+    // Node graph coloring: nodes of one color share no spring, color c lists
+    // its nodes in nodeColorOrder [nodeColorOffset[c], nodeColorOffset[c + 1])
+    std::vector<unsigned int>    nodeColorOffset;
+    std::vector<unsigned int>    nodeColorOrder;
+
+    SpringData();
+    size_t size() const { return node1.size(); }
+    void reserve(size_t n);
+    void resize(size_t n); // Exact count up front, then set() in any order
+    void clear();
+    unsigned int add(unsigned char t, const ParticleData& particles, unsigned int n1, unsigned int n2, double k);
+    void set(unsigned int s, unsigned char t, const ParticleData& particles, unsigned int n1, unsigned int n2, double k);
+
+    void removeZeroCoeff();
+    void removeType(unsigned char t);
+    void renumberNodes(const std::vector<unsigned int>& newIndex);
+
+    void applyInternalForce(unsigned int s, ParticleData& particles) const;
+
+    void buildAdjacency(size_t nodeCount);
+    void computeInternalForce(unsigned int s, const ParticleData& particles);
+    void gatherInternalForce(unsigned int n, ParticleData& particles) const;
+    Vec3 gatherRecord(unsigned int n, Vec3 sum = Vec3()) const;
+    unsigned int degree(unsigned int n) const { return adjOffset[n + 1] - adjOffset[n]; }
+
+    void buildColoring(size_t nodeCount);
+    unsigned int colorCount() const { return colorOffset.empty() ? 0 : (unsigned int)(colorOffset.size() - 1); }
+    void buildNodeColoring(size_t nodeCount);
+    unsigned int nodeColorCount() const { return nodeColorOffset.empty() ? 0 : (unsigned int)(nodeColorOffset.size() - 1); }
+
+private:
+    void compact(const std::vector<char>& keep);
+    void permute(const std::vector<unsigned int>& order);
+};
+
+#endif
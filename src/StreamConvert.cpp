@@ -0,0 +1,41 @@
+#include <algorithm>
+
+#include "StreamConvert.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static void convertBlock(const double* src, float* dst, size_t count)
+{
+    size_t i = 0;
+#if defined(__AVX__)
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_ps(dst + i, _mm256_cvtpd_ps(_mm256_loadu_pd(src + i)));
+        _mm_storeu_ps(dst + i + 4, _mm256_cvtpd_ps(_mm256_loadu_pd(src + i + 4)));
+    }
+#elif defined(_M_X64) || defined(__SSE2__)
+    for (; i + 4 <= count; i += 4) {
+        __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(src + i));
+        __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(src + i + 2));
+        _mm_storeu_ps(dst + i, _mm_movelh_ps(lo, hi));
+    }
+#endif
+    for (; i < count; i++)
+        dst[i] = (float)src[i];
+}
+
+void convertToFloat(const double* src, float* dst, size_t count)
+{
+    // Large enough to amortize the scheduling, a multiple of the SIMD width
+    const size_t BLOCK = 8192;
+    int blocks = (int)((count + BLOCK - 1) / BLOCK);
+
+#pragma omp parallel for if (blocks > 1)
+    for (int b = 0; b < blocks; b++) {
+        size_t first = (size_t)b * BLOCK;
+        convertBlock(src + first, dst + first, std::min(BLOCK, count - first));
+    }
+}
@@ -0,0 +1,11 @@
+#ifndef STREAM_CONVERT_H
+#define STREAM_CONVERT_H
+
+#include <cstddef>
+
+// dst[i] = (float)src[i]. Simulation streams (Vec3 is three packed doubles)
+// to GPU vertex data: SIMD inside blocks, blocks split across threads.
+// dst may be write-combined mapped memory, it is only written, in order.
+void convertToFloat(const double* src, float* dst, size_t count);
+
+#endif
@@ -4,11 +4,8 @@
 #include <glm/glm.hpp>
 #include "ICollider.h"
 #include "Vectors.h"
-#include "Display.h"
 #include "SweptSphere.h"
 
-class SweptSphereRender;
-
 class SweptSphereCollider : public ICollider {
 public:
     Vec3 center1;
@@ -18,12 +15,11 @@ public:
     glm::vec4 color;
 
     SweptSphere* sweptsphere;
-    SweptSphereRender* renderer;
 
     SweptSphereCollider();
     SweptSphereCollider(Vec3 c1, float r1, Vec3 c2, float r2);
     void resolveCollision(ClothData* data) override;
-    void render() override;
+    bool closestSurface(Vec3 p, Vec3& surface, Vec3& normal) override;
     ~SweptSphereCollider();
 };
 
@@ -4,7 +4,6 @@
 #include "SweptSphereTri.h"
 #include "SweptSphereTriCollider.h"
 #include "Vectors.h"
-#include "Display.h"
 
 SweptSphereTriCollider::SweptSphereTriCollider() {
     center1 = Vec3(0.0f, -1.0f, -5.0f);
@@ -18,7 +17,6 @@ SweptSphereTriCollider::SweptSphereTriCollider() {
 	glm::vec4 color(1.0f, 0.647f, 0.0f, 1.0f);
 
 	sweptspheretri = new SweptSphereTri(center1, radius1, center2, radius2, center3, radius3, color, 64, 32, 24);
-	renderer = new SweptSphereTriRender(sweptspheretri);
 
 	precompute();
 }
@@ -31,17 +29,15 @@ SweptSphereTriCollider::SweptSphereTriCollider(Vec3 c1, float r1, Vec3 c2, float
 	glm::vec4 color(1.0f, 0.647f, 0.0f, 1.0f);
 
 	sweptspheretri = new SweptSphereTri(center1, radius1, center2, radius2, center3, radius3, color, 16, 8, 6);
-	renderer = new SweptSphereTriRender(sweptspheretri);
 
 	precompute();
 }
 
 SweptSphereTriCollider::~SweptSphereTriCollider() {
 	delete sweptspheretri;
-	delete renderer;
 }
 
-void SweptSphereTriCollider::resolveCollision(ClothData* data)
+bool SweptSphereTriCollider::closestSurface(Vec3 p, Vec3& surface, Vec3& normal)
 {
     const double inflate = 1.05;
     const double inflate1 = radius1 * inflate;
@@ -58,7 +54,7 @@ void SweptSphereTriCollider::resolveCollision(ClothData* data)
         };
 
     // Utility: proiezione su sfera (senza sqrt extra)
-    auto projectOnSphere = [&](const Vec3& p, const Vec3& c, double safeR, double safeRSq, Vec3& outPos)->bool {
+    auto projectOnSphere = [&](const Vec3& p, const Vec3& c, double safeR, double safeRSq, Vec3& outPos, Vec3& outNormal)->bool {
         Vec3 d = Vec3(p.x - c.x, p.y - c.y, p.z - c.z);
         double dsq = Vec3::dot(d, d);
         if (dsq < safeRSq) {
@@ -67,68 +63,64 @@ void SweptSphereTriCollider::resolveCollision(ClothData* data)
             // posizione = centro + direzione * r_sicuro
             Vec3 supp = d * (safeR * invLen);
             outPos = Vec3(c.x + supp.x, c.y + supp.y, c.z + supp.z);
+            outNormal = d * invLen;
             return true;
         }
         return false;
         };
 
-    const double fric = sweptspheretri->friction;
-
     // Dati compattati per i 3 centri/raggi (cos loopiamo)
     const Vec3  C[3] = { center1, center2, center3 };
     const double R[3] = { inflate1, inflate2, inflate3 };
     const double RSq[3] = { r1Sq, r2Sq, r3Sq };
 
-#pragma omp parallel for
-    for (int i = 0; i < (int)data->nodes.size(); ++i)
-    {
-        Node* node = data->nodes[i];
-        Vec3  p = data->getWorldPos(node);
+    // 1) broad-phase
+    if (likelyOutside(p)) {
+        return false;
+    }
 
-        // 1) broad-phase
-        if (likelyOutside(p)) {
-            continue;
+    // 2) prova rapida contro le 3 sfere pure
+    for (int s = 0; s < 3; ++s) {
+        if (projectOnSphere(p, C[s], R[s], RSq[s], surface, normal)) {
+            return true;
         }
+    }
 
-        // 2) prova rapida contro le 3 sfere pure
-        bool hit = false;
-        Vec3 newPos;
-        for (int s = 0; s < 3; ++s) {
-            if (projectOnSphere(p, C[s], R[s], RSq[s], newPos)) {
-                hit = true;
-                break;
-            }
-        }
-        if (hit) {
-            data->setWorldPos(node, newPos);
-            node->velocity = node->velocity * fric;
-            continue;
+    // 3) sfera interpolata (SSTri): early-out cheap
+    Vec3 nPlane = Vec3::cross(tri_v0, tri_v1);
+    double nLen = nPlane.length();
+    if (nLen > 1e-30) {
+        nPlane = nPlane / nLen;
+        double distPlane = std::fabs(Vec3::dot(p - tri_a, nPlane));
+        double maxR = std::max(radius1, std::max(radius2, radius3));
+        if (distPlane > maxR * 1.2) {
+            return false;
         }
+    }
 
-        // 3) sfera interpolata (SSTri): early-out cheap
-        Vec3 nPlane = Vec3::cross(tri_v0, tri_v1);
-        double nLen = nPlane.length();
-        if (nLen > 1e-30) {
-            nPlane = nPlane / nLen;
-            double distPlane = std::fabs(Vec3::dot(p - tri_a, nPlane));
-            double maxR = std::max(radius1, std::max(radius2, radius3));
-            if (distPlane > maxR * 1.2) {
-                continue;
-            }
-        }
+    Vec3  cInterp;
+    float rInterp;
+    float bary[3];
+    if (!closestSphere(p, cInterp, rInterp, bary)) {
+        return false;
+    }
 
-        Vec3  cInterp;
-        float rInterp;
-        float bary[3];
-        if (!closestSphere(p, cInterp, rInterp, bary)) {
-            continue;
-        }
+    const double safeR = (double)rInterp * inflate;
+    const double safeRSq = safeR * safeR;
+    return projectOnSphere(p, cInterp, safeR, safeRSq, surface, normal);
+}
+
+void SweptSphereTriCollider::resolveCollision(ClothData* data)
+{
+    const double fric = sweptspheretri->friction;
 
-        const double safeR = (double)rInterp * inflate;
-        const double safeRSq = safeR * safeR;
-        if (projectOnSphere(p, cInterp, safeR, safeRSq, newPos)) {
-            data->setWorldPos(node, newPos);
-            node->velocity = node->velocity * fric;
+#pragma omp parallel for
+    for (int i = 0; i < (int)data->particles.size(); ++i)
+    {
+        Vec3 surface, normal;
+        if (closestSurface(data->getWorldPos(i), surface, normal)) {
+            data->setWorldPos(i, surface);
+            data->particles.velocity[i] = data->particles.velocity[i] * fric;
         }
     }
 }
@@ -304,7 +296,3 @@ bool SweptSphereTriCollider::closestSphere(const Vec3& p, Vec3& centerOut, float
     if (baryOut) { baryOut[0] = (float)bestB[0]; baryOut[1] = (float)bestB[1]; baryOut[2] = (float)bestB[2]; }
     return true;
 }
-
-void SweptSphereTriCollider::render() {
-	renderer->flush();
-}
\ No newline at end of file
@@ -1,14 +1,12 @@
 #ifndef SWEPT_SPHERE_TRI_COLLIDER_H
 #define SWEPT_SPHERE_TRI_COLLIDER_H
 
+#include <array>
 #include <glm/glm.hpp>
 #include "ICollider.h"
 #include "Vectors.h"
-#include "Display.h"
 #include "SweptSphereTri.h"
 
-class SweptSphereTriRender;
-
 class SweptSphereTriCollider : public ICollider {
 public:
     Vec3 center1;
@@ -30,14 +28,14 @@ public:
     double bb_radiusSq;            // (max(|Ci - bb_center| + ri))^2
 
     SweptSphereTri* sweptspheretri;
-    SweptSphereTriRender* renderer;
 
     SweptSphereTriCollider();
     SweptSphereTriCollider(Vec3 c1, float r1, Vec3 c2, float r2, Vec3 c3, float r3);
     void resolveCollision(ClothData* data) override;
+    bool closestSurface(Vec3 p, Vec3& surface, Vec3& normal) override;
     bool closestSphere(const Vec3& p, Vec3& centerOut, float& radiusOut, float* baryOut = nullptr) const;
     std::array<double, 3> baryFromPlaneProjectionFast(const Vec3& p) const;
-    static void projectSimplex(double b[3]);    void render() override;
+    static void projectSimplex(double b[3]);
     void precompute();
     ~SweptSphereTriCollider();
 };
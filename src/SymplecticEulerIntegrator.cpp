@@ -1,3 +1,4 @@
+#include <omp.h>
 #include <iostream>
 
 #include "SymplecticEulerIntegrator.h"
@@ -18,37 +19,36 @@ SymplecticEulerIntegrator::SymplecticEulerIntegrator(ClothData* data) : cloth(da
 
     initCoeff();
     removeZeroCoeffSpring();
+    if (stencil.build(*cloth))
+        std::cout << "- grid stencil: " << stencil.getWidth() << " x " << stencil.getHeight() << std::endl;
+    else
+        cloth->springs.buildAdjacency(cloth->particles.size());
 }
 
 void SymplecticEulerIntegrator::initCoeff() {
     for (int s = 0; s < cloth->springs.size(); ++s) {
-        if (cloth->springs[s]->id == 0) {
-            cloth->springs[s]->hookCoef = stretchingCoef;
+        if (cloth->springs.type[s] == 0) {
+            cloth->springs.hookCoef[s] = stretchingCoef;
         }
-        else if (cloth->springs[s]->id == 1 || cloth->springs[s]->id == 2) {
-            cloth->springs[s]->hookCoef = shearCoef;
+        else if (cloth->springs.type[s] == 1 || cloth->springs.type[s] == 2) {
+            cloth->springs.hookCoef[s] = shearCoef;
         }
-        else if (cloth->springs[s]->id == 3) {
-            cloth->springs[s]->hookCoef = bendingCoef;
+        else if (cloth->springs.type[s] == 3) {
+            cloth->springs.hookCoef[s] = bendingCoef;
         }
     }
 }
 
 void SymplecticEulerIntegrator::removeZeroCoeffSpring() {
     // Remove springs with zero coefficient
-    for (int i = 0; i < cloth->springs.size(); i++) {
-        if (cloth->springs[i]->hookCoef == 0.0) {
-            delete cloth->springs[i];
-            cloth->springs.erase(cloth->springs.begin() + i);
-            i--;
-        }
-    }
+    cloth->springs.removeZeroCoeff();
 }
 
 void SymplecticEulerIntegrator::unpin() {
-    for (int i = 0; i < cloth->nodes.size(); ++i) {
-        if (cloth->nodes[i]->isFixed) {
-            cloth->nodes[i]->isFixed = false;
+    ParticleData& p = cloth->particles;
+    for (int i = 0; i < p.size(); ++i) {
+        if (p.isFixed[i]) {
+            p.isFixed[i] = 0;
         }
     }
 }
@@ -67,27 +67,58 @@ void SymplecticEulerIntegrator::update() {
 
 void SymplecticEulerIntegrator::computeForce(double timeStep, Vec3 gravity)
 {
-    /** Nodes **/
-#pragma omp parallel for
-    for (int i = 0; i < cloth->nodes.size(); i++)
-    {
-        cloth->nodes[i]->addForce(gravity * cloth->nodes[i]->mass);
+    ParticleData& p = cloth->particles;
+
+    if (stencil.active()) {
+        stencil.computeForce(p, gravity);
+        return;
     }
+
+    if (omp_get_max_threads() == 1) {
+        // One thread: scatter straight into both endpoints, same sums in the
+        // same order as the gather, without the records' extra pass
+        for (int i = 0; i < p.size(); i++)
+        {
+            p.force[i] += gravity * p.mass[i];
+        }
+        for (int i = 0; i < cloth->springs.size(); i++)
+        {
+            cloth->springs.applyInternalForce(i, p);
+        }
+        return;
+    }
+
     /** Springs **/
+    // Each spring only writes its own force record
 #pragma omp parallel for
     for (int i = 0; i < cloth->springs.size(); i++)
     {
-        cloth->springs[i]->applyInternalForce(timeStep);
+        cloth->springs.computeInternalForce(i, p);
+    }
+    /** Nodes **/
+    // Each node only writes its own force: gravity, then incident springs
+#pragma omp parallel for
+    for (int i = 0; i < p.size(); i++)
+    {
+        p.force[i] += gravity * p.mass[i];
+        cloth->springs.gatherInternalForce(i, p);
     }
 }
 
 void SymplecticEulerIntegrator::integrate(double airFriction, double timeStep)
 {
+    ParticleData& p = cloth->particles;
+
     /** Node **/
 #pragma omp parallel for
-    for (int i = 0; i < cloth->nodes.size(); i++)
+    for (int i = 0; i < p.size(); i++)
     {
-        cloth->nodes[i]->SimpletticIntegrate(timeStep);
+        if (!p.isFixed[i]) // Only non-fixed nodes take integration
+        {
+            p.velocity[i] += (p.force[i] / p.mass[i]) * timeStep;
+            p.position[i] += p.velocity[i] * timeStep;
+        }
+        p.force[i].setZeroVec();
     }
 }
 
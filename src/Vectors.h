@@ -2,8 +2,9 @@
 #define VECTORS_H
 
 #include <math.h>
+#include <stdio.h>
 #include <vector>
-#include "matrices.h"
+#include "Matrices.h"
 
 struct Vec2
 {
@@ -0,0 +1,182 @@
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+#include "VertexBlockDescentIntegrator.h"
+#include "ClothData.h"
+#include "Vectors.h"
+
+VertexBlockDescentIntegrator::VertexBlockDescentIntegrator(ClothData* data)
+    : cloth(data),
+    inertia(data->particles.size())
+{
+    TIME_STEP = 0.01;
+    stretchingCoef = 10000.0f;
+    bendingCoef = 4000.0f;
+    shearCoef = 500.0;
+    gravity = Vec3(0.0, -9.8, 0.0);
+
+    solverIterations = 10;
+
+    initCoeff();
+    removeZeroCoeffSpring();
+    cloth->springs.buildAdjacency(data->particles.size());
+    cloth->springs.buildNodeColoring(data->particles.size());
+
+    std::cout << "Method: " << std::endl;
+    std::cout << "- VBD" << std::endl;
+    std::cout << "- colors: " << cloth->springs.nodeColorCount() << ", iterations: " << solverIterations << std::endl;
+}
+
+void VertexBlockDescentIntegrator::initCoeff() {
+    //0: quad springs
+    //1: first diagonal spring (\)
+    //2: second diagonal spring (/)
+    //3: quad springs
+
+    for (int s = 0; s < cloth->springs.size(); ++s) {
+        if (cloth->springs.type[s] == 0) {
+            cloth->springs.hookCoef[s] = stretchingCoef;
+        }
+        else if (cloth->springs.type[s] == 1 || cloth->springs.type[s] == 2) {
+            cloth->springs.hookCoef[s] = shearCoef;
+        }
+        else if (cloth->springs.type[s] == 3) {
+            cloth->springs.hookCoef[s] = bendingCoef;
+        }
+    }
+}
+
+void VertexBlockDescentIntegrator::removeZeroCoeffSpring() {
+    // Remove springs with zero coefficient
+    cloth->springs.removeZeroCoeff();
+}
+
+void VertexBlockDescentIntegrator::unpin() {
+    ParticleData& p = cloth->particles;
+    for (int i = 0; i < p.size(); ++i) {
+        if (p.isFixed[i]) {
+            p.isFixed[i] = 0;
+        }
+    }
+}
+
+std::vector<ICollider*> VertexBlockDescentIntegrator::getColliders() {
+    return colliders;
+}
+
+void VertexBlockDescentIntegrator::addCollider(ICollider* col) {
+    colliders.push_back(col);
+}
+
+void VertexBlockDescentIntegrator::update() {
+    ParticleData& p = cloth->particles;
+
+    for (int i = 0; i < p.size(); i++) {
+        p.old_position[i] = p.position[i];
+    }
+
+    integrate(TIME_STEP);
+
+    //Handling collisions
+    for (auto collider : colliders) {
+        if (collider) {
+            collider->resolveCollision(cloth);
+        }
+    }
+}
+
+void VertexBlockDescentIntegrator::solveNode(unsigned int n, double timeStep)
+{
+    // Local incremental potential of node n, its neighbours fixed:
+    //   m/(2h^2) |x - y|^2 + sum k/2 (|x - x_o| - rest)^2 + damping
+    // One Newton step x += H^-1 f, f = -gradient. The spring Hessian
+    // k (u u^T + (1 - rest/len) (I - u u^T)) is clamped to PSD under
+    // compression so H stays SPD.
+    ParticleData& p = cloth->particles;
+    const SpringData& springs = cloth->springs;
+    double mh = p.mass[n] / (timeStep * timeStep);
+    double dc = springs.dampCoef / timeStep;
+
+    Vec3 x = p.position[n];
+    Vec3 moved = x - p.old_position[n];
+    Vec3 f = (Vec3(inertia[n]) - x) * mh;
+
+    // H = diag I + sum w u u^T, the six distinct entries of the sum kept apart
+    double diag = mh;
+    double uxx = 0.0, uxy = 0.0, uxz = 0.0, uyy = 0.0, uyz = 0.0, uzz = 0.0;
+
+    for (unsigned int k = springs.adjOffset[n]; k < springs.adjOffset[n + 1]; k++) {
+        unsigned int s = springs.adjSpring[k] >> 1;
+        unsigned int other = (springs.adjSpring[k] & 1) ? springs.node1[s] : springs.node2[s];
+
+        Vec3 d = x - p.position[other];
+        double len = d.length();
+        Vec3 u = d / len;
+        double ks = springs.hookCoef[s];
+        double c = std::max(1.0 - springs.restLen[s] / len, 0.0);
+
+        // Damping of the relative motion along the spring, v = (x - x_n) / h
+        double along = Vec3::dot(moved - (Vec3(p.position[other]) - p.old_position[other]), u);
+        f -= u * (ks * (len - springs.restLen[s]) + dc * along);
+
+        double w = ks * (1.0 - c) + dc;
+        diag += ks * c;
+        uxx += w * u.x * u.x;
+        uxy += w * u.x * u.y;
+        uxz += w * u.x * u.z;
+        uyy += w * u.y * u.y;
+        uyz += w * u.y * u.z;
+        uzz += w * u.z * u.z;
+    }
+
+    Mat3x3 H;
+    H(0, 0) = diag + uxx; H(0, 1) = uxy;        H(0, 2) = uxz;
+    H(1, 0) = uxy;        H(1, 1) = diag + uyy; H(1, 2) = uyz;
+    H(2, 0) = uxz;        H(2, 1) = uyz;        H(2, 2) = diag + uzz;
+
+    Mat3x3 Hinv = H.inverse();
+    p.position[n] += Vec3(Hinv(0, 0) * f.x + Hinv(0, 1) * f.y + Hinv(0, 2) * f.z,
+                          Hinv(1, 0) * f.x + Hinv(1, 1) * f.y + Hinv(1, 2) * f.z,
+                          Hinv(2, 0) * f.x + Hinv(2, 1) * f.y + Hinv(2, 2) * f.z);
+}
+
+void VertexBlockDescentIntegrator::integrate(double timeStep)
+{
+    ParticleData& p = cloth->particles;
+    const SpringData& springs = cloth->springs;
+
+    /** Nodes **/
+    // Inertial target, also the initial guess
+#pragma omp parallel for
+    for (int i = 0; i < p.size(); i++)
+    {
+        if (p.isFixed[i]) {
+            inertia[i] = p.position[i];
+        }
+        else {
+            inertia[i] = p.position[i] + p.velocity[i] * timeStep + gravity * (timeStep * timeStep);
+            p.position[i] = inertia[i];
+        }
+    }
+
+    // Gauss-Seidel over the colors, Jacobi-like inside one: a node only reads
+    // neighbours of other colors
+    for (int iter = 0; iter < solverIterations; iter++) {
+        for (unsigned int c = 0; c < springs.nodeColorCount(); c++) {
+#pragma omp parallel for
+            for (int k = (int)springs.nodeColorOffset[c]; k < (int)springs.nodeColorOffset[c + 1]; k++) {
+                unsigned int n = springs.nodeColorOrder[k];
+                if (!p.isFixed[n])
+                    solveNode(n, timeStep);
+            }
+        }
+    }
+
+#pragma omp parallel for
+    for (int i = 0; i < p.size(); ++i) {
+        if (!p.isFixed[i]) {
+            p.velocity[i] = (p.position[i] - p.old_position[i]) / timeStep;
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef VERTEX_BLOCK_DESCENT_INTEGRATOR_H
+#define VERTEX_BLOCK_DESCENT_INTEGRATOR_H
+
+#include <vector>
+#include "ClothData.h"
+#include "IClothSimulator.h"
+#include "Vectors.h"
+#include "Matrices.h"
+#include "ICollider.h"
+
+// Implicit Euler as energy minimization, solved with Vertex Block Descent
+// (Chen et al. 2024): block Gauss-Seidel where every node takes a 3x3 Newton
+// step on the incremental potential of its incident springs, others fixed.
+// Nodes of one color share no spring and are updated in parallel. Needs
+// only the node adjacency, no global system.
+class VertexBlockDescentIntegrator : public IClothSimulator {
+public:
+	VertexBlockDescentIntegrator(ClothData* data);
+	void update() override;
+	void unpin() override;
+	std::vector<ICollider*> getColliders() override;
+	void addCollider(ICollider* col) override;
+
+private:
+	ClothData* cloth;
+	std::vector<ICollider*> colliders;
+	Vec3 gravity;
+	double TIME_STEP;
+	double stretchingCoef;
+	double bendingCoef;
+	double shearCoef;
+
+	int solverIterations; // Sweeps over all colors per step
+
+	AlignedVector<Vec3> inertia; // x_n + h v_n + h^2 g, the initial guess
+
+	void initCoeff();
+	void removeZeroCoeffSpring();
+	void solveNode(unsigned int n, double timeStep);
+	void integrate(double timeStep);
+};
+
+#endif
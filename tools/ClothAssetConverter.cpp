@@ -0,0 +1,70 @@
+// Precompiles OBJ garments into .clothbin assets, written next to each mesh
+// and picked up by ClothData instead of the OBJ while they are up to date.
+//
+//   ClothAssetConverter [mesh.obj ...]    (default: every Mesh/*.obj)
+//
+// Built from this file plus src/ClothData, ParticleData, SpringData,
+// NodeOrdering, ObjLoader, MappedFile and ClothAsset. No OpenGL needed.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+
+#include "../src/ClothData.h"
+#include "../src/ClothAsset.h"
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> sources(argv + 1, argv + argc);
+    if (sources.empty()) {
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator("Mesh", ec)) {
+            if (entry.path().extension() == ".obj")
+                sources.push_back(entry.path().generic_string());
+        }
+        if (sources.empty()) {
+            std::cerr << "No OBJ meshes in Mesh/" << std::endl;
+            return 1;
+        }
+    }
+
+    int failed = 0;
+    for (const std::string& source : sources) {
+        auto start = std::chrono::steady_clock::now();
+        ClothData cloth;
+        cloth.BuildFromObj(source);
+        if (cloth.particles.size() == 0) {
+            failed++;
+            continue;
+        }
+        double objTime = secondsSince(start);
+
+        std::string path = ClothAsset::pathFor(source);
+        std::string error;
+        if (!ClothAsset::save(cloth, path, source, error)) {
+            std::cerr << source << ": " << error << std::endl;
+            failed++;
+            continue;
+        }
+
+        start = std::chrono::steady_clock::now();
+        ClothData check;
+        if (!ClothAsset::load(path, source, check, error)) {
+            std::cerr << path << ": " << error << std::endl;
+            failed++;
+            continue;
+        }
+        double assetTime = secondsSince(start);
+
+        std::cout << source << " -> " << path << std::endl;
+        std::cout << "- OBJ build: " << objTime * 1000.0 << " ms, asset load: " << assetTime * 1000.0 << " ms" << std::endl;
+    }
+    return failed == 0 ? 0 : 1;
+}
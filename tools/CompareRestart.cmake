@@ -0,0 +1,20 @@
+# A run restarted after STEPS steps must end where a fresh run of STEPS
+# steps does: compares the centroid line HeadlessRunner prints.
+#
+#   cmake -DRUNNER=path/to/HeadlessRunner -DMETHOD=M -DSTEPS=N -P CompareRestart.cmake
+
+math(EXPR total "${STEPS} * 2")
+execute_process(COMMAND ${RUNNER} --shape grid:40 --method ${METHOD} --steps ${STEPS}
+    OUTPUT_VARIABLE fresh RESULT_VARIABLE freshResult)
+execute_process(COMMAND ${RUNNER} --shape grid:40 --method ${METHOD} --steps ${total} --restart ${STEPS}
+    OUTPUT_VARIABLE restarted RESULT_VARIABLE restartedResult)
+if (NOT freshResult EQUAL 0 OR NOT restartedResult EQUAL 0)
+    message(FATAL_ERROR "HeadlessRunner failed: ${freshResult} fresh, ${restartedResult} restarted")
+endif()
+
+string(REGEX MATCH "centroid: [^\n]*" freshEnd "${fresh}")
+string(REGEX MATCH "centroid: [^\n]*" restartedEnd "${restarted}")
+if (freshEnd STREQUAL "" OR NOT freshEnd STREQUAL restartedEnd)
+    message(FATAL_ERROR "Restarted run differs from a fresh one:\n  fresh:     ${freshEnd}\n  restarted: ${restartedEnd}")
+endif()
+message(STATUS "${METHOD}: ${freshEnd}")
@@ -0,0 +1,214 @@
+// Runs a cloth simulation without a window or GL context, for batch servers
+// and benchmarks, and reports timings.
+//
+//   HeadlessRunner [--shape S] [--method M] [--steps N] [--collider C]...
+//                  [--ordering O] [--threads N] [--unpin N] [--restart N]
+//                  [--newton-iterations N] [--newton-tol T]
+//
+//   --shape     grid, grid:N, grid:NxM or tshirt (default grid)
+//   --method    any ClothInstance::create method (default SymplecticEuler)
+//   --steps     simulation steps, one update each (default 600)
+//   --collider  sphere[:x,y,z]  box[:x,y,z]  capsule[:x,y,z,x,y,z]
+//               sweptsphere  sweptspheretri  ground  spheremesh[:file]
+//               (repeatable, defaults as in the GUI)
+//   --ordering  None, RCM, ND or Morton (default None)
+//   --threads   OpenMP threads (default all)
+//   --unpin     step at which the pinned nodes are released
+//   --restart   step at which the cloth is reset to its initial state
+//   --newton-iterations, --newton-tol
+//               Newton iterations per step and relative residual at which
+//               they stop (ImplicitNewton, NewtonPCG; default 4 and 1e-3)
+//
+// Newton methods also report their average Newton and PCG iterations per
+// step and the relative residual reached by the last step.
+//
+// Built from this file plus the simulation core: every src/*.cpp except
+// Globals, Material and stb_image_impl, which belong to the GL application.
+
+#include <omp.h>
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+#include "../src/ClothInstance.h"
+#include "../src/ImplicitNewtonIntegrator.h"
+#include "../src/SphereCollider.h"
+#include "../src/AABBCollider.h"
+#include "../src/CapsuleCollider.h"
+#include "../src/SweptSphereCollider.h"
+#include "../src/SweptSphereTriCollider.h"
+#include "../src/GroundCollider.h"
+#include "../src/SphereMeshesCollider.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// "x,y,z,..." after the colon of a collider spec
+static std::vector<double> parseNumbers(const std::string& text)
+{
+    std::vector<double> values;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        values.push_back(std::stod(item));
+    return values;
+}
+
+static ICollider* createCollider(const std::string& spec)
+{
+    size_t colon = spec.find(':');
+    std::string kind = spec.substr(0, colon);
+    std::string args = colon == std::string::npos ? "" : spec.substr(colon + 1);
+    std::vector<double> v = (args.empty() || kind == "spheremesh") ? std::vector<double>() : parseNumbers(args);
+
+    if (kind == "sphere")
+        return v.size() == 3 ? new SphereCollider(Vec3(v[0], v[1], v[2])) : new SphereCollider();
+    if (kind == "box")
+        return v.size() == 3 ? new AABBCollider(Vec3(v[0], v[1], v[2])) : new AABBCollider();
+    if (kind == "capsule")
+        return v.size() == 6 ? new CapsuleCollider(Vec3(v[0], v[1], v[2]), Vec3(v[3], v[4], v[5])) : new CapsuleCollider();
+    if (kind == "sweptsphere")
+        return new SweptSphereCollider();
+    if (kind == "sweptspheretri")
+        return new SweptSphereTriCollider();
+    if (kind == "ground")
+        return new GroundCollider();
+    if (kind == "spheremesh")
+        return new SphereMeshesCollider(args.empty() ? "Mesh/female_neutral_SM.txt" : args);
+    return nullptr;
+}
+
+static void usage()
+{
+    std::cerr << "Usage: HeadlessRunner [--shape S] [--method M] [--steps N] [--collider C]..."
+                 " [--ordering O] [--threads N] [--unpin N] [--restart N]"
+                 " [--newton-iterations N] [--newton-tol T]" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    std::string shape = "grid";
+    std::string method = "SymplecticEuler";
+    std::string ordering = "None";
+    std::vector<std::string> colliders;
+    int steps = 600;
+    int unpinStep = -1;
+    int restartStep = -1;
+    int newtonIterations = 4; // ImplicitNewtonIntegrator's defaults
+    double newtonTol = 1e-3;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--shape") shape = value;
+        else if (arg == "--method") method = value;
+        else if (arg == "--steps") steps = std::stoi(value);
+        else if (arg == "--collider") colliders.push_back(value);
+        else if (arg == "--ordering") ordering = value;
+        else if (arg == "--threads") omp_set_num_threads(std::stoi(value));
+        else if (arg == "--unpin") unpinStep = std::stoi(value);
+        else if (arg == "--restart") restartStep = std::stoi(value);
+        else if (arg == "--newton-iterations") newtonIterations = std::stoi(value);
+        else if (arg == "--newton-tol") newtonTol = std::stod(value);
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    /** Setup **/
+    Clock::time_point start = Clock::now();
+    ClothInstance* cloth = ClothInstance::create(shape, method, NodeOrdering::fromString(ordering));
+    if (cloth == nullptr || cloth->getData()->particles.size() == 0) {
+        std::cerr << "Can't create " << shape << " with " << method << std::endl;
+        return 1;
+    }
+    for (const std::string& spec : colliders) {
+        ICollider* collider = createCollider(spec);
+        if (collider == nullptr) {
+            std::cerr << "Unknown collider: " << spec << std::endl;
+            return 1;
+        }
+        cloth->addCollider(collider);
+    }
+    ImplicitNewtonIntegrator* newton = dynamic_cast<ImplicitNewtonIntegrator*>(cloth->getSimulator());
+    if (newton != nullptr)
+        newton->setNewtonIterations(newtonIterations, newtonTol);
+    double setupTime = millisecondsSince(start);
+
+    /** Simulation **/
+    std::vector<double> stepTimes(steps);
+    long long newtonTotal = 0;
+    long long cgTotal = 0;
+    start = Clock::now();
+    for (int s = 0; s < steps; s++) {
+        if (s == unpinStep)
+            cloth->unpin();
+        if (s == restartStep)
+            cloth->restart();
+        Clock::time_point stepStart = Clock::now();
+        cloth->update();
+        stepTimes[s] = millisecondsSince(stepStart);
+        if (newton != nullptr) {
+            newtonTotal += newton->getIterations();
+            cgTotal += newton->getCGIterations();
+        }
+    }
+    double totalTime = millisecondsSince(start);
+
+    /** Report **/
+    const ClothData* data = cloth->getData();
+    const ParticleData& p = data->particles;
+    Vec3 centroid;
+    double maxSpeed = 0.0;
+    bool finite = true;
+    for (size_t i = 0; i < p.size(); i++) {
+        centroid += p.position[i];
+        maxSpeed = std::max(maxSpeed, Vec3(p.velocity[i]).length());
+        finite = finite && std::isfinite(p.position[i].x) && std::isfinite(p.position[i].y) && std::isfinite(p.position[i].z);
+    }
+    centroid = centroid / (double)std::max<size_t>(p.size(), 1);
+    centroid += data->clothPos;
+
+    std::vector<double> sorted = stepTimes;
+    std::sort(sorted.begin(), sorted.end());
+    double mean = steps > 0 ? totalTime / steps : 0.0;
+    double median = steps > 0 ? sorted[steps / 2] : 0.0;
+    double p95 = steps > 0 ? sorted[std::min(steps - 1, steps * 95 / 100)] : 0.0;
+    double worst = steps > 0 ? sorted.back() : 0.0;
+
+    std::cout << "Headless run:" << std::endl;
+    std::cout << "- shape: " << shape << ", method: " << method << ", ordering: " << ordering
+              << ", threads: " << omp_get_max_threads() << std::endl;
+    std::cout << "- nodes: " << p.size() << ", springs: " << data->springs.size()
+              << ", colliders: " << colliders.size() << std::endl;
+    std::cout << "- setup: " << setupTime << " ms" << std::endl;
+    std::cout << "- steps: " << steps << " in " << totalTime << " ms ("
+              << (totalTime > 0.0 ? steps * 1000.0 / totalTime : 0.0) << " steps/s)" << std::endl;
+    std::cout << "- step ms: mean " << mean << ", median " << median << ", p95 " << p95 << ", max " << worst << std::endl;
+    std::cout << "- centroid: (" << centroid.x << ", " << centroid.y << ", " << centroid.z << "), max speed: " << maxSpeed << std::endl;
+    if (newton != nullptr && steps > 0) {
+        const std::vector<double>& residuals = newton->getResidualHistory();
+        double relative = residuals.empty() || residuals.front() == 0.0 ? 0.0 : residuals.back() / residuals.front();
+        std::cout << "- newton iterations/step: " << (double)newtonTotal / steps
+                  << ", cg iterations/step: " << (double)cgTotal / steps
+                  << ", last relative residual: " << relative << std::endl;
+    }
+    if (!finite) {
+        std::cout << "- diverged: non-finite positions" << std::endl;
+        return 2;
+    }
+    return 0;
+}